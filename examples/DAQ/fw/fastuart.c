@@ -80,6 +80,30 @@ int uart_post (const void *data, size_t len)
 	return 0;
 }
 
+#ifdef UART_DMA_BASE
+
+int uart_dma_post (const void *data, size_t len)
+{
+	uintptr_t offset = (uintptr_t) data - (BASE_ADDR + UART_DMA_MEMORY);
+	if (offset % 4 || offset + len > 64 << 10) return -EINVAL;
+	if (uart_background_send_len || uart_dma->control.enable) return -EBUSY;
+	uart_dma->addr  = offset;
+	uart_dma->count = len;
+	uart_dma->control.reg = 0xB0; // enable, with IRQ at completion
+	return 0;
+}
+
+void uart_dma_isr (void)
+{
+	dma_control_t c = uart_dma->control;
+	uart_dma->control = c; // ACK IRQ
+	// mark the end of the transfer as uart_isr does, and signal it once sent:
+	uart_control->tx = send_idle;
+	uart_control->irq.tx_empty = 1;
+}
+
+#endif
+
 void uart_recv (bool enable)
 {
 	disable_interrupts();
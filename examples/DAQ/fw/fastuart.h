@@ -126,6 +126,40 @@ enum {
 static volatile ser_data_t    * const uart_data    = (void *) (BASE_ADDR + 0x0000);
 static volatile ser_control_t * const uart_control = (void *) (BASE_ADDR + 0x0004);
 
+#ifdef UART_DMA_BASE
+
+/**************************************
+ ** DMA to TX FIFO (optional)        **
+ **************************************/
+
+// UART_DMA_BASE is the offset of the DMA engine registers, and UART_DMA_MEMORY
+// that of the shared memory it reads from, both relative to BASE_ADDR.
+
+typedef union dma_control_u
+{
+	struct {
+		uint8_t reg;
+	};
+	struct {
+		uint8_t            : 4;
+		uint8_t irq_flag   : 1; // W1C
+		uint8_t irq_enable : 1; // RW
+		uint8_t            : 1;
+		uint8_t enable     : 1; // RW AUTO0 - write 0 to abort
+	};
+} dma_control_t;
+
+typedef struct dma_s
+{
+	uint32_t      addr;         // RW - byte offset in shared memory
+	uint32_t      count;        // RW - bytes left to transfer
+	dma_control_t control;
+} dma_t;
+
+static volatile dma_t * const uart_dma = (void *) (BASE_ADDR + UART_DMA_BASE);
+
+#endif
+
 // UART driver:
 enum uart_events {
 	uart_tx_done  = 1,
@@ -136,5 +170,10 @@ extern const void *uart_send (const void *data, size_t len);
 extern int         uart_post (const void *data, size_t len);
 extern void        uart_recv (bool enable);
 extern void        uart_isr  (void);
+#ifdef UART_DMA_BASE
+// like uart_post, but for data in shared memory, which is moved by the DMA engine:
+extern int         uart_dma_post (const void *data, size_t len);
+extern void        uart_dma_isr  (void);
+#endif
 
 #endif
@@ -9,6 +9,7 @@
 
 #include "build_date.h"
 #include "platform.h"
+#include "trace.h"
 #define BASE_ADDR 0xE0000000
 
 // UART registers:
@@ -35,6 +36,7 @@ enum int_mask {
 	irq_tmr1 = 2,
 	irq_tmr2 = 4,
 	irq_daqc = 8,
+	irq_dmac = 16,
 };
 
 // DAQ registers:
@@ -65,6 +67,40 @@ enum misc_events {
 	daq_capture_done  = 8,
 };
 
+// Streaming mode: the DAQ fills the two halves of the shared memory in turn,
+// with an IRQ as each one is complete, and each bank is sent while the other
+// fills, preceded by a header frame. A bank completed while the previous one
+// is still being sent is dropped, and counted as an overrun.
+// Define STREAM_BANKS as 0 for a single capture of the whole memory instead.
+#ifndef STREAM_BANKS
+#define STREAM_BANKS 16
+#endif
+
+// Sampling rate [Hz], set by tmr1 from the 100 MHz clock: lower it to find the
+// highest one the UART can sustain, about 62.5 kHz at 1 MB/s with 16-byte frames.
+#ifndef SAMPLE_RATE
+#define SAMPLE_RATE 100000
+#endif
+
+enum {
+	sample_rate  = SAMPLE_RATE,
+	tmr_clock    = 100000000,
+	bank_words   = (32 << 10) / 4,      // 4 channels per frame, 2048 frames per bank
+	stream_magic = 0x4D525453,          // "STRM"
+};
+
+typedef struct stream_header_s
+{
+	uint32_t magic;
+	uint32_t seq;                       // banks completed so far, including this one
+	uint32_t overruns;                  // banks dropped so far
+	uint32_t rate;                      // sampling rate [Hz]
+} stream_header_t;
+
+static volatile unsigned bank_pending;  // 1 or 2 (bank_ready bits) if a bank awaits sending
+static volatile bool     bank_sending;
+static volatile uint32_t bank_seq, bank_overruns;
+
 
 // 120-point "sinusoidal" waveform, amplitude = 100, offset = 125:
 static const uint8_t pwm_values[] = {
@@ -101,6 +137,15 @@ void daqc_isr (void)
 {
 	daq_t status = *daqc;
 	*daqc = status; // ACK IRQ
+	TRACE(trace_capture_done, status.reg);
+	if (status.continuous) {
+		++bank_seq;
+		if (bank_sending || bank_pending) {
+			++bank_overruns;
+			return;
+		}
+		bank_pending = status.bank_ready;
+	}
 	event_set_nolock(daq_capture_done);
 }
 
@@ -111,6 +156,9 @@ void generic_isr (void)
 	if (irqs & irq_tmr1) tmr1_isr();
 	if (irqs & irq_tmr2) tmr2_isr();
 	if (irqs & irq_daqc) daqc_isr();
+#ifdef UART_DMA_BASE
+	if (irqs & irq_dmac) uart_dma_isr();
+#endif
 }
 
 void wait_for_pty_connection (void)
@@ -126,16 +174,46 @@ void wait_for_pty_connection (void)
 
 int main (void)
 {
+	TRACE(trace_start);
 	uart_control->tx_fifo.enable = 1;
 	uart_control->rx_fifo.enable = 1;
-	intc->enable = irq_uart | irq_tmr2 | irq_daqc;
-	tmr1->period = 1000 - 1; // 100 kHz -- DAQ sampling rate
-	tmr1->value  =  500;     // 50% duty cycle
+	intc->enable = irq_uart | irq_tmr2 | irq_daqc | irq_dmac;
+	tmr1->period = tmr_clock / sample_rate - 1; // DAQ sampling rate
+	tmr1->value  = tmr_clock / sample_rate / 2; // 50% duty cycle
 	tmr2->period =  250 - 1; // 400 kHz -- PWM frequency
+#if STREAM_BANKS
+	wait_for_pty_connection();
+	daqc->reg    = 0xF0;     // continuous double buffered capture
+	for (unsigned sent = 0; sent < STREAM_BANKS; ++sent) {
+		wait_for_event(daq_capture_done);
+		disable_interrupts();
+		volatile uint32_t *bank = bank_pending == 1 ? mem : mem + bank_words;
+		stream_header_t header = {stream_magic, bank_seq, bank_overruns, sample_rate};
+		bank_pending = 0;
+		bank_sending = true;
+		enable_interrupts();
+		TRACE(trace_bank, bank == mem ? 0 : 1, header.seq, header.overruns);
+		uart_send(&header, sizeof header);
+#ifdef UART_DMA_BASE
+		uart_dma_post((void *) bank, bank_words * 4);
+#else
+		uart_post((void *) bank, bank_words * 4);
+#endif
+		wait_for_event(uart_tx_done);
+		bank_sending = false;
+	}
+	daqc->reg    = 0x10;     // stop
+#else
 	daqc->reg    = 0xB0;     // single buffer capture
 	wait_for_event(daq_capture_done);
 	wait_for_pty_connection();
+#ifdef UART_DMA_BASE
+	uart_dma_post((void *) mem, 64 << 10);
+#else
 	uart_post((void *) mem, 64 << 10);
+#endif
 	wait_for_event(uart_tx_done);
+#endif
+	TRACE(trace_tx_done);
 	return 0;
 }
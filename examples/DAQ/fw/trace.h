@@ -0,0 +1,40 @@
+// trace.h
+// Firmware trace points, logged by QEMU through the RTL bridge trace port
+// (-global RTL-bridge.trace=FILE) without involving the VHDL simulation.
+//
+// TRACE(id, args...) costs one store per argument (up to 15, 32 bits each)
+// plus one for the ID, that selects the format string in trace.fmt when the
+// records are decoded with trace-decode. Compiled out unless TRACE_BASE is
+// defined, as the trace port is not mapped otherwise.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#ifdef TRACE_BASE
+
+static volatile uint32_t * const trace_port = (void *) (TRACE_BASE);
+
+#define TRACE(id, ...) do { \
+	const uint32_t trace_args_[] = {0, ##__VA_ARGS__}; \
+	for (unsigned trace_i_ = 1; trace_i_ < sizeof trace_args_ / sizeof *trace_args_; ++trace_i_) \
+		trace_port[trace_i_] = trace_args_[trace_i_]; \
+	trace_port[0] = (id); \
+} while (0)
+
+#else
+
+#define TRACE(id, ...) do { } while (0)
+
+#endif
+
+// trace point IDs, matching trace.fmt:
+enum trace_id {
+	trace_start = 1,
+	trace_capture_done,
+	trace_tx_done,
+	trace_bank,
+};
+
+#endif
@@ -27,17 +27,27 @@ library common;
 
 library cosim;
 	use cosim.all;
+	use cosim.HDLprof.all;
+	use cosim.ANAmodel.all;
 
 use work.all;
 
 entity testbench is
+	generic (
+		clk_period  : time    := 10 ns;
+		analog_vhdl : boolean := false; -- evaluate the analog part in VHDL rather than in C
+		stimulus    : string  := "";    -- WAV file to feed the 4 DAQ channels instead of the analog part
+		stimulus_format : string := "wav";
+		irq_sources : boolean := false  -- also send the raw IRQ sources to QEMU, for its INTC model
+	);
 end entity;
 
 architecture functional of testbench is
 	-- CPU interface:
 	signal clk : std_logic;
 	signal rst : std_logic;
-	signal irq_cpu : std_logic_vector(0 downto 0) := b"0";
+	signal irq_cpu : std_logic_vector(8 downto 0) := (others => '0');
+	signal irq_intc : std_logic;
 	signal axi_cpu : t_axilite_if(
 		write_address_channel(awaddr(31 downto 0)),
 		write_data_channel(wdata(31 downto 0), wstrb(3 downto 0)),
@@ -46,7 +56,7 @@ architecture functional of testbench is
 	);
 
 	-- Peripheral interfaces:
-	subtype peripherals is integer range 0 to 5;
+	subtype peripherals is integer range 0 to 6;
 	type axi_peripheral_buses_t is array (integer range <>) of t_axilite_if(
 		write_address_channel(awaddr(31 downto 0)),
 		write_data_channel(wdata(31 downto 0), wstrb(3 downto 0)),
@@ -62,7 +72,8 @@ architecture functional of testbench is
 		2 => ( addr => X"00002000", mask => X"FFFFF000" ), -- PWM2
 		3 => ( addr => X"00003000", mask => X"FFFFF000" ), -- DAQ
 		4 => ( addr => X"00004000", mask => X"FFFFF000" ), -- INTC
-		5 => ( addr => X"00010000", mask => X"FFFF0000" )  -- MEM  (64 KiB)
+		5 => ( addr => X"00010000", mask => X"FFFF0000" ), -- MEM  (64 KiB)
+		6 => ( addr => X"00005000", mask => X"FFFFF000" )  -- DMA
 	);
 	signal xbar_outputs_m2s : axi_lite_m2s_vec_t(peripherals);
 	signal xbar_outputs_s2m : axi_lite_s2m_vec_t(peripherals);
@@ -72,7 +83,7 @@ architecture functional of testbench is
 	signal host_tx : std_logic;
 
 	-- INTC inputs:
-	signal irqs : std_logic_vector(3 downto 0) := (others => '0');
+	signal irqs : std_logic_vector(4 downto 0) := (others => '0');
 
 	-- RAM signals:
 	signal Aaddr : std_logic_vector (15 downto 0);
@@ -85,6 +96,18 @@ architecture functional of testbench is
 	signal Bdin  : std_logic_vector (31 downto 0);
 	signal Bwe   : std_logic_vector ( 3 downto 0);
 	signal Ben   : std_logic;
+	-- port B is shared by the DAQ writer and the DMA reader, with the former taking precedence:
+	signal Waddr : std_logic_vector (15 downto 0);
+	signal Wwe   : std_logic_vector ( 3 downto 0);
+	signal Wen   : std_logic;
+	signal Raddr : std_logic_vector (15 downto 0);
+	signal Ren   : std_logic;
+
+	-- DMA to UART stream:
+	signal stream_data  : std_logic_vector(31 downto 0);
+	signal stream_keep  : std_logic_vector( 3 downto 0);
+	signal stream_valid : std_logic;
+	signal stream_ready : std_logic;
 
 	-- PWM signals:
 	signal pwm1  : std_logic;
@@ -94,6 +117,7 @@ architecture functional of testbench is
 	signal mem_enable : std_logic;
 	signal pwm_real, analog : real := 0.0;
 	signal data : signed(31 downto 0);
+	signal daq_input : std_logic_vector(127 downto 0);
 
 begin
 
@@ -173,6 +197,10 @@ begin
 		------------------------------------------------------------------------
 		uart_tx         => host_rx,
 		uart_rx         => host_tx,
+		stream_data     => stream_data,
+		stream_keep     => stream_keep,
+		stream_valid    => stream_valid,
+		stream_ready    => stream_ready,
 		irq             => irqs(0)
 	);
 
@@ -265,14 +293,14 @@ begin
 		S_AXI_RVALID    => axi_peripheral_buses(3).read_data_channel.rvalid,
 		S_AXI_RREADY    => axi_peripheral_buses(3).read_data_channel.rready,
 		------------------------------------------------------------------------
-		mem_bank        => Baddr(15),
+		mem_bank        => Waddr(15),
 		mem_enable      => mem_enable,
 		mem_interrupt   => irqs(3)
 	);
 
 	dev_intc : entity IRQ_controller
 	generic map (
-		INTERRUPT_SOURCES => 4
+		INTERRUPT_SOURCES => 5
 	)
 	port map (
 		irq_inputs => irqs,
@@ -301,9 +329,12 @@ begin
 		S_AXI_RVALID    => axi_peripheral_buses(4).read_data_channel.rvalid,
 		S_AXI_RREADY    => axi_peripheral_buses(4).read_data_channel.rready,
 		------------------------------------------------------------------------
-		irq             => irq_cpu(0)
+		irq             => irq_intc
 	);
 
+	-- INTC output in bit 0, or in bit 8 above the raw sources (RTL-bridge.irq-sources=on):
+	irq_cpu <= irq_intc & b"000" & irqs when irq_sources else b"00000000" & irq_intc;
+
 	dev_ramc : entity SRAM_controller
 	port map (
 		------------------------------------------------------------------------
@@ -338,15 +369,56 @@ begin
 		EN   => Aen
 	);
 
+	dev_dma : entity DMA_controller
+	port map (
+		------------------------------------------------------------------------
+		-- AXI subordinate bus:
+		------------------------------------------------------------------------
+		S_AXI_ACLK      => clk,
+		S_AXI_ARESETN   => rst,
+		S_AXI_AWADDR    => axi_peripheral_buses(6).write_address_channel.awaddr(4 downto 0),
+		S_AXI_AWPROT    => axi_peripheral_buses(6).write_address_channel.awprot,
+		S_AXI_AWVALID   => axi_peripheral_buses(6).write_address_channel.awvalid,
+		S_AXI_AWREADY   => axi_peripheral_buses(6).write_address_channel.awready,
+		S_AXI_WDATA     => axi_peripheral_buses(6).write_data_channel.wdata,
+		S_AXI_WSTRB     => axi_peripheral_buses(6).write_data_channel.wstrb,
+		S_AXI_WVALID    => axi_peripheral_buses(6).write_data_channel.wvalid,
+		S_AXI_WREADY    => axi_peripheral_buses(6).write_data_channel.wready,
+		S_AXI_BRESP     => axi_peripheral_buses(6).write_response_channel.bresp,
+		S_AXI_BVALID    => axi_peripheral_buses(6).write_response_channel.bvalid,
+		S_AXI_BREADY    => axi_peripheral_buses(6).write_response_channel.bready,
+		S_AXI_ARADDR    => axi_peripheral_buses(6).read_address_channel.araddr(4 downto 0),
+		S_AXI_ARPROT    => axi_peripheral_buses(6).read_address_channel.arprot,
+		S_AXI_ARVALID   => axi_peripheral_buses(6).read_address_channel.arvalid,
+		S_AXI_ARREADY   => axi_peripheral_buses(6).read_address_channel.arready,
+		S_AXI_RDATA     => axi_peripheral_buses(6).read_data_channel.rdata,
+		S_AXI_RRESP     => axi_peripheral_buses(6).read_data_channel.rresp,
+		S_AXI_RVALID    => axi_peripheral_buses(6).read_data_channel.rvalid,
+		S_AXI_RREADY    => axi_peripheral_buses(6).read_data_channel.rready,
+		------------------------------------------------------------------------
+		mem_addr        => Raddr,
+		mem_enable      => Ren,
+		mem_grant       => not Wen,
+		mem_data        => Bdout,
+		stream_data     => stream_data,
+		stream_keep     => stream_keep,
+		stream_valid    => stream_valid,
+		stream_ready    => stream_ready,
+		dma_interrupt   => irqs(4)
+	);
+
+	Baddr <= Waddr when Wen = '1' else Raddr;
+	Bwe   <= Wwe   when Wen = '1' else B"0000";
+	Ben   <= Wen or Ren;
+
 	dev_ramw : entity mem_writer
 	port map (
 		clk => clk,
-		A   => Baddr,
+		A   => Waddr,
 		D   => Bdin,
-		EN  => Ben,
-		WE  => Bwe,
-		data_input( 31 downto  0) => std_logic_vector(data),
-		data_input(127 downto 32) => (others => '0'),
+		EN  => Wen,
+		WE  => Wwe,
+		data_input    => daq_input,
 		data_valid    => pwm1,
 		enable        => mem_enable
 	);
@@ -363,14 +435,14 @@ begin
 		Brst  => not rst,
 		Bclk  => clk,
 		Baddr => Baddr,
-		Bdout => open ,
+		Bdout => Bdout,
 		Bdin  => Bdin ,
 		Bwe   => Bwe  ,
 		Ben   => Ben
 	);
 
 	cpu : entity CPUemu
-	generic map (fifo_path => "/tmp/test/fifo")
+	generic map (clk_period => clk_period, fifo_path => "/tmp/test/fifo")
 	port map (
 		M_AXI_ACLK      => clk,
 		M_AXI_ARESETN   => rst,
@@ -404,35 +476,95 @@ begin
 	);
 
 
-	-- analog part emulation:
+	-- DAQ inputs, either the analog part below on channel 0 or a recording on all channels:
 
-	DA : process (clk, pwm1)
-		constant k : real := 1.0E-3;
-		variable x : real := 0.0;
-		variable a : real := 0.0;
-	begin
-		if rising_edge(clk) then
-			x := +1.0 when pwm2 = '1' else -1.0 when pwm2 = '0' else 0.0;
-			a := a + x;
-		end if;
-		if rising_edge(pwm1) then
-			pwm_real <= a * k;
-			a := 0.0;
-		end if;
-	end process;
-
-	LP : entity lowpass
-	port map (
-		clk => pwm1,
-		clk_enable => '1',
-		reset => not rst,
-		filter_in  => pwm_real,
-		filter_out => analog
-	);
+	synthetic : if stimulus = "" generate
+		daq_input( 31 downto  0) <= std_logic_vector(data);
+		daq_input(127 downto 32) <= (others => '0');
+	end generate;
 
-	AD : process (analog)
+	recorded : if stimulus /= "" generate
+		signal values : integer_vector(0 to 3);
 	begin
-		data <= to_signed(integer(analog * real(2**20)), 32);
-	end process;
+		wav : entity WAVemu
+		generic map (file_path => stimulus, format => stimulus_format, channels => 4)
+		port map (
+			strobe => pwm1,
+			value  => values
+		);
+		lanes : for i in 0 to 3 generate
+			daq_input(32 * i + 31 downto 32 * i) <= std_logic_vector(to_signed(values(i), 32));
+		end generate;
+	end generate;
+
+
+	-- analog part emulation:
+
+	analog_c : if not analog_vhdl generate
+		-- same integrator and lowpass as below, but evaluated by ANAmodel only at PWM1 strobes:
+		DA_AD : process (pwm1, pwm2)
+			constant model : integer := ana_create(1, clk_period);
+			variable setup : boolean := true;
+			constant prof  : integer := prof_register("testbench analog model");
+		begin
+			prof_enter(prof);
+			if setup then
+				ana_integrator(model, 1.0E-3);
+				ana_gain(model, 2.9976619221815000E-02);
+				ana_biquad(model, 1.4512925247604927E-01, -1.8976443564817516E-01, 1.4512925247604927E-01,
+				                 -1.8057476739787599E+00,  9.0470757680961666E-01);
+				ana_biquad(model, 4.8516689753535464E-01,  7.1017658668477757E-02, 4.8516689753535475E-01,
+				                 -1.7270234562463465E+00,  7.6060194538848092E-01);
+				ana_delay(model, 2); -- input and output registers of the lowpass
+				setup := false;
+			end if;
+			if pwm2'event then
+				ana_input(model, 0, +1.0 when pwm2 = '1' else -1.0 when pwm2 = '0' else 0.0);
+			end if;
+			if rising_edge(pwm1) then
+				ana_sample(model);
+				analog <= ana_output(model, 0);
+				data   <= to_signed(ana_adc(model, 0, real(2**20), 32), 32);
+			end if;
+			prof_leave(prof);
+		end process;
+	end generate;
+
+	analog_hdl : if analog_vhdl generate
+		DA : process (clk, pwm1)
+			constant k : real := 1.0E-3;
+			variable x : real := 0.0;
+			variable a : real := 0.0;
+			constant prof : integer := prof_register("testbench DA");
+		begin
+			prof_enter(prof);
+			if rising_edge(clk) then
+				x := +1.0 when pwm2 = '1' else -1.0 when pwm2 = '0' else 0.0;
+				a := a + x;
+			end if;
+			if rising_edge(pwm1) then
+				pwm_real <= a * k;
+				a := 0.0;
+			end if;
+			prof_leave(prof);
+		end process;
+
+		LP : entity lowpass
+		port map (
+			clk => pwm1,
+			clk_enable => '1',
+			reset => not rst,
+			filter_in  => pwm_real,
+			filter_out => analog
+		);
+
+		AD : process (analog)
+			constant prof : integer := prof_register("testbench AD");
+		begin
+			prof_enter(prof);
+			data <= to_signed(integer(analog * real(2**20)), 32);
+			prof_leave(prof);
+		end process;
+	end generate;
 
 end architecture;
@@ -262,7 +262,7 @@ entity mem_writer is
 		clk : in  std_logic;
 		A   : out std_logic_vector (15 downto 0);
 		D   : out std_logic_vector (31 downto 0);
-		EN  : out std_logic;
+		EN  : out std_logic := '0';
 		RST : out std_logic;
 		WE  : out std_logic_vector (3 downto 0);
 		data_input : in std_logic_vector (127 downto 0);
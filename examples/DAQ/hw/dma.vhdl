@@ -0,0 +1,311 @@
+-- DMA engine streaming shared memory into a peripheral FIFO.
+--
+-- Copyright © 2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+-- Department of Information Engineering
+-- Università Politecnica delle Marche (ITALY)
+--
+-- SPDX-License-Identifier: CERN-OHL-W-2.0
+
+-- Register map:
+-- 0 : ADDR    (RW) - byte offset of the next word to read from memory
+-- 1 : COUNT   (RW) - bytes still to be transferred (up to 64 KiB)
+-- 2 : CONTROL (RW) - same layout as the DAQ control register:
+--   [7]  EN    enable: write 1 to start, 0 to abort, reads 1 while busy
+--   [5]  IE    irq_enable
+--   [4]  IF    irq_flag, set at the end of the transfer (W1C)
+--
+-- Memory is read through a port shared with other writers, that only grant
+-- it when idle; each word is then offered on the stream output together with
+-- the mask of its valid bytes, until acknowledged by a one-cycle "ready".
+
+
+library ieee;
+	use ieee.std_logic_1164.all;
+	use ieee.numeric_std.all;
+
+entity DMA_controller is
+	generic (
+		C_S_AXI_DATA_WIDTH : integer := 32;
+		C_S_AXI_ADDR_WIDTH : integer := 5
+	);
+	port (
+		-- memory read port:
+		mem_addr        : out std_logic_vector(15 downto 0);
+		mem_enable      : out std_logic;
+		mem_grant       : in  std_logic;
+		mem_data        : in  std_logic_vector(31 downto 0);
+		-- stream output:
+		stream_data     : out std_logic_vector(31 downto 0);
+		stream_keep     : out std_logic_vector( 3 downto 0);
+		stream_valid    : out std_logic;
+		stream_ready    : in  std_logic;
+		-- completion IRQ:
+		dma_interrupt   : out std_logic;
+		------------------------------------------------------------------------
+		-- AXI subordinate bus:
+		------------------------------------------------------------------------
+		S_AXI_ACLK      : in  std_logic;
+		S_AXI_ARESETN   : in  std_logic;
+		S_AXI_AWADDR    : in  std_logic_vector(C_S_AXI_ADDR_WIDTH-1   downto 0);
+		S_AXI_AWPROT    : in  std_logic_vector(2 downto 0);
+		S_AXI_AWVALID   : in  std_logic;
+		S_AXI_AWREADY   : out std_logic;
+		S_AXI_WDATA     : in  std_logic_vector(C_S_AXI_DATA_WIDTH-1   downto 0);
+		S_AXI_WSTRB     : in  std_logic_vector(C_S_AXI_DATA_WIDTH/8-1 downto 0);
+		S_AXI_WVALID    : in  std_logic;
+		S_AXI_WREADY    : out std_logic;
+		S_AXI_BRESP     : out std_logic_vector(1 downto 0);
+		S_AXI_BVALID    : out std_logic;
+		S_AXI_BREADY    : in  std_logic;
+		S_AXI_ARADDR    : in  std_logic_vector(C_S_AXI_ADDR_WIDTH-1   downto 0);
+		S_AXI_ARPROT    : in  std_logic_vector(2 downto 0);
+		S_AXI_ARVALID   : in  std_logic;
+		S_AXI_ARREADY   : out std_logic;
+		S_AXI_RDATA     : out std_logic_vector(C_S_AXI_DATA_WIDTH-1   downto 0);
+		S_AXI_RRESP     : out std_logic_vector(1 downto 0);
+		S_AXI_RVALID    : out std_logic;
+		S_AXI_RREADY    : in  std_logic
+		------------------------------------------------------------------------
+	);
+end DMA_controller;
+
+architecture behavioural of DMA_controller is
+	-- AXI4LITE signals:
+	-- write channels:
+	signal axi_waddr   : std_logic_vector(C_S_AXI_ADDR_WIDTH-1   downto 0);
+	signal axi_wdata   : std_logic_vector(C_S_AXI_DATA_WIDTH-1   downto 0);
+	signal axi_wstrb   : std_logic_vector(C_S_AXI_DATA_WIDTH/8-1 downto 0);
+	signal axi_awready : std_logic;
+	signal axi_wready  : std_logic;
+	signal axi_bresp   : std_logic_vector(1 downto 0);
+	signal axi_bvalid  : std_logic;
+	-- read channels:
+	signal axi_raddr   : std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+	signal axi_rdata   : std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+	signal axi_arready : std_logic;
+	signal axi_rresp   : std_logic_vector(1 downto 0);
+	signal axi_rvalid  : std_logic;
+
+	signal got_raddr   : std_logic;
+	signal got_waddr   : std_logic;
+	signal got_wdata   : std_logic;
+
+	-- registers:
+	signal reg_dma_addr    : unsigned(15 downto 2);
+	signal reg_dma_count   : unsigned(16 downto 0);
+	signal reg_dma_control : std_logic_vector( 7 downto 0);
+	-- transfer engine state:
+	type   state_t is (idle, fetch, capture, send);
+	signal state           : state_t;
+
+begin
+	-- IRQ output:
+	dma_interrupt <= reg_dma_control(5) and reg_dma_control(4);
+
+	mem_addr <= std_logic_vector(reg_dma_addr) & B"00";
+
+	-- AXI handling:
+
+	S_AXI_AWREADY <= axi_awready;
+	S_AXI_WREADY  <= axi_wready;
+	S_AXI_BVALID  <= axi_bvalid;
+	S_AXI_BRESP   <= axi_bresp;
+
+	S_AXI_ARREADY <= axi_arready;
+	S_AXI_RDATA   <= axi_rdata;
+	S_AXI_RRESP   <= axi_rresp;
+	S_AXI_RVALID  <= axi_rvalid;
+
+	writes : process (S_AXI_ACLK) is
+		variable done : boolean;
+
+		procedure reg_dma_reset is
+		begin
+			reg_dma_addr    <= (others => '0');
+			reg_dma_count   <= (others => '0');
+			reg_dma_control <= (others => '0');
+			state           <= idle;
+			mem_enable      <= '0';
+			stream_valid    <= '0';
+		end procedure;
+
+		procedure reg_dma_write (
+			signal data : in std_logic_vector(7 downto 0);
+			signal mask : in std_logic_vector
+		) is
+		begin
+			if mask = "0" then return; end if;
+			reg_dma_control(7 downto 5) <= data(7 downto 5);
+			if data(4) = '1' then
+				reg_dma_control(4) <= '0';
+			end if;
+			if data(7) = '0' then
+				-- abort:
+				state        <= idle;
+				mem_enable   <= '0';
+				stream_valid <= '0';
+			elsif reg_dma_control(7) = '0' then
+				state <= fetch;
+			end if;
+		end procedure;
+
+		procedure reg_dma_clock is
+		begin
+			case state is
+				when idle =>
+					null;
+				when fetch =>
+					-- the read takes place at the first clock edge the port is granted:
+					if reg_dma_count = 0 then
+						state <= idle;
+						reg_dma_control(7) <= '0'; -- EN
+						reg_dma_control(4) <= '1'; -- irq_flag
+					elsif mem_enable = '1' and mem_grant = '1' then
+						mem_enable <= '0';
+						state <= capture;
+					else
+						mem_enable <= '1';
+					end if;
+				when capture =>
+					stream_data  <= mem_data;
+					stream_valid <= '1';
+					if reg_dma_count < 4 then
+						for i in 0 to 3 loop
+							stream_keep(i) <= '1' when i < reg_dma_count else '0';
+						end loop;
+					else
+						stream_keep <= B"1111";
+					end if;
+					state <= send;
+				when send =>
+					if stream_ready = '1' then
+						stream_valid  <= '0';
+						reg_dma_addr  <= reg_dma_addr + 1;
+						reg_dma_count <= reg_dma_count - 4 when reg_dma_count >= 4 else (others => '0');
+						state <= fetch;
+					end if;
+			end case;
+		end procedure;
+	begin
+		if rising_edge(S_AXI_ACLK) then
+			if S_AXI_ARESETN = '0' then
+				axi_awready <= '0';
+				axi_wready  <= '0';
+				axi_bvalid  <= '0';
+				got_waddr   <= '0';
+				got_wdata   <= '0';
+				reg_dma_reset;
+			else
+				reg_dma_clock;
+
+				-- address handshake:
+				if S_AXI_AWVALID = '1' and axi_awready = '1' then
+					axi_waddr   <= S_AXI_AWADDR(C_S_AXI_ADDR_WIDTH-1 downto 0);
+					got_waddr   <= '1';
+					axi_awready <= '0';
+				else
+					axi_awready <= not got_waddr;
+				end if;
+
+				-- data handshake:
+				if S_AXI_WVALID = '1' and axi_wready = '1' then
+					axi_wdata   <= S_AXI_WDATA;
+					axi_wstrb   <= S_AXI_WSTRB;
+					got_wdata   <= '1';
+					axi_wready  <= '0';
+				else
+					axi_wready  <= not got_wdata;
+				end if;
+
+				-- response handshake:
+				if S_AXI_BREADY = '1' and axi_bvalid = '1' then
+					axi_bvalid <= '0';
+				end if;
+
+				-- register write handling (ADDR and COUNT are read-only while busy):
+				done := false;
+				if got_waddr = '1' and got_wdata = '1' then
+					axi_bresp <= b"00";
+					case axi_waddr(4 downto 2) is
+					when b"000" =>
+						if reg_dma_control(7) = '1' then
+							axi_bresp <= b"10";
+						else
+							reg_dma_addr <= unsigned(axi_wdata(15 downto 2));
+						end if;
+						done := true;
+					when b"001" =>
+						if reg_dma_control(7) = '1' then
+							axi_bresp <= b"10";
+						else
+							reg_dma_count <= unsigned(axi_wdata(16 downto 0));
+						end if;
+						done := true;
+					when b"010" =>
+						reg_dma_write(axi_wdata(7 downto 0), axi_wstrb(0 downto 0));
+						done := true;
+					when others =>
+						axi_bresp <= b"11";
+						done := true;
+					end case;
+					if done then
+						axi_bvalid <= '1';
+						got_wdata <= '0';
+						got_waddr <= '0';
+					end if;
+				end if;
+
+			end if;
+		end if;
+	end process;
+
+	reads : process (S_AXI_ACLK) is
+	begin
+		if rising_edge(S_AXI_ACLK) then
+			if S_AXI_ARESETN = '0' then
+				axi_arready <= '0';
+				axi_rvalid  <= '0';
+				got_raddr   <= '0';
+			else
+				-- address handshake:
+				if S_AXI_ARVALID = '1' and axi_arready = '1' then
+					axi_raddr   <= S_AXI_ARADDR(C_S_AXI_ADDR_WIDTH-1 downto 0);
+					got_raddr   <= '1';
+					axi_arready <= '0';
+				else
+					axi_arready <= not got_raddr;
+				end if;
+
+				-- response handshake:
+				if S_AXI_RREADY = '1' and axi_rvalid = '1' then
+					axi_rvalid <= '0';
+					got_raddr <= '0';
+				else
+
+				-- register read handling:
+				if got_raddr = '1' then
+					case axi_raddr(4 downto 2) is
+					when b"000" =>
+						axi_rresp <= b"00";
+						axi_rdata <= X"0000" & std_logic_vector(reg_dma_addr) & B"00";
+						axi_rvalid <= '1';
+					when b"001" =>
+						axi_rresp <= b"00";
+						axi_rdata <= B"000" & X"000" & std_logic_vector(reg_dma_count);
+						axi_rvalid <= '1';
+					when b"010" =>
+						axi_rresp <= b"00";
+						axi_rdata <= X"000000" & reg_dma_control;
+						axi_rvalid <= '1';
+					when others =>
+						axi_rresp <= b"11";
+						axi_rdata <= X"00000000";
+						axi_rvalid <= '1';
+					end case;
+				end if;
+				end if;
+			end if;
+		end if;
+	end process;
+
+end behavioural;
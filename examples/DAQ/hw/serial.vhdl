@@ -9,6 +9,7 @@
 -- This is a FIFO-based UART that operates at a fixed baud rate of 1/10 of the clock frequency.
 -- Up to 4 bytes of data can be enqueued at a time with a single 32-bit write.
 -- Reads always return 9 bits of data, with the ninth bit denoting a special event.
+-- The TX FIFO can also be fed by a stream input, e.g. from a DMA engine, a word at a time.
 
 
 library ieee;
@@ -330,6 +331,13 @@ entity UART_interface is
 		uart_cts        : in  std_logic := '1';
 		uart_rts        : out std_logic;
 		------------------------------------------------------------------------
+		-- stream input to the TX FIFO ("keep" flags the valid bytes):
+		------------------------------------------------------------------------
+		stream_data     : in  std_logic_vector(31 downto 0) := (others => '0');
+		stream_keep     : in  std_logic_vector( 3 downto 0) := (others => '1');
+		stream_valid    : in  std_logic := '0';
+		stream_ready    : out std_logic;
+		------------------------------------------------------------------------
 		-- AXI subordinate bus:
 		------------------------------------------------------------------------
 		S_AXI_ACLK      : in  std_logic;
@@ -415,6 +423,8 @@ architecture mine of UART_interface is
 
 	signal wcount    : natural range 0 to 3;
 	signal rcount    : natural range 0 to 3;
+	signal scount    : natural range 0 to 3;
+	signal stream_ack : std_logic;
 
 
 begin
@@ -475,11 +485,14 @@ begin
 	S_AXI_RRESP   <= axi_rresp;
 	S_AXI_RVALID  <= axi_rvalid;
 
+	stream_ready  <= stream_ack;
+
 	writes : process (S_AXI_ACLK) is
 		variable done : boolean;
 	begin
 		if rising_edge(S_AXI_ACLK) then
 			tx_push <= '0';
+			stream_ack <= '0';
 			if S_AXI_ARESETN = '0' then
 				axi_awready <= '0';
 				axi_wready  <= '0';
@@ -496,6 +509,7 @@ begin
 				rx_enable   <= '0';
 				tx_enable   <= '0';
 				tx_level    <= '1';
+				scount      <=  0;
 			else
 
 				-- address handshake:
@@ -598,6 +612,23 @@ begin
 					end if;
 				end if;
 
+				-- stream input, only while no bus write is pending and one byte every other
+				-- cycle, so that "tx_full" always accounts for the previous byte:
+				if stream_valid = '1' and stream_ack = '0' and got_wdata = '0' and tx_push = '0' then
+					if stream_keep(scount) = '0' or tx_full = '0' then
+						if stream_keep(scount) = '1' then
+							tx_data <= b"0" & stream_data(scount * 8 + 7 downto scount * 8);
+							tx_push <= '1';
+						end if;
+						if scount < 3 then
+							scount <= scount + 1;
+						else
+							scount <= 0;
+							stream_ack <= '1';
+						end if;
+					end if;
+				end if;
+
 			end if;
 		end if;
 	end process;
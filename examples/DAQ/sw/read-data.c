@@ -48,9 +48,64 @@ static bool serial_open (const char *filename)
 
 static int lines = 0;
 
+// streaming mode: each bank of samples is preceded by a header frame (see fw/test-daq.c):
+enum { stream_magic = 0x4D525453 };
+
+static struct {
+	bool     active;
+	uint32_t banks;         // received
+	uint32_t seq;           // completed by the DAQ, as of the last header
+	uint32_t overruns;      // dropped by the firmware, as of the last header
+	uint32_t rate;          // sampling rate [Hz]
+	uint64_t frames;        // received in all banks
+	uint32_t bank_frames;   // received since the last header
+	uint32_t max_frames;    // largest bank seen
+	struct timespec start;
+} stream;
+
+static void stream_header (uint32_t const *data)
+{
+	if (!stream.active) clock_gettime(CLOCK_MONOTONIC, &stream.start);
+	if (stream.bank_frames > stream.max_frames) stream.max_frames = stream.bank_frames;
+	stream.active      = true;
+	stream.bank_frames = 0;
+	stream.seq         = data[1];
+	stream.overruns    = data[2];
+	stream.rate        = data[3];
+	++stream.banks;
+}
+
+static void stream_report (void)
+{
+	// sustained if every bank completed by the DAQ was delivered:
+	if (!stream.active) return;
+	if (stream.bank_frames > stream.max_frames) stream.max_frames = stream.bank_frames;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	double wall = (now.tv_sec - stream.start.tv_sec) + 1e-9 * (now.tv_nsec - stream.start.tv_nsec);
+	double ratio = stream.seq ? (double) stream.banks / stream.seq : 0.0;
+	fprintf(stderr, "Stream: %u banks received out of %u acquired (%u overruns), %llu frames\n",
+		stream.banks, stream.seq, stream.overruns, (unsigned long long) stream.frames);
+	if (stream.frames < (uint64_t) stream.banks * stream.max_frames)
+		fprintf(stderr, "Stream: %llu frames missing from incomplete banks\n",
+			(unsigned long long) ((uint64_t) stream.banks * stream.max_frames - stream.frames));
+	fprintf(stderr, "Stream: sustained %.1f%% of %u Hz x 4 channels (%.0f Hz effective, %.0f kB/s simulated)\n",
+		100.0 * ratio, stream.rate, ratio * stream.rate, ratio * stream.rate * 16e-3);
+	// how fast the co-simulation itself runs:
+	double fps = wall > 0 ? stream.frames / wall : 0.0;
+	fprintf(stderr, "Stream: %.1f s wall-clock, %.0f frames/s (%.2f%% of real time)\n",
+		wall, fps, stream.rate ? 100.0 * fps / stream.rate : 0.0);
+}
+
 static void process (uint32_t const *data)
 {
+	if (data[0] == stream_magic) {
+		stream_header(data);
+		return;
+	}
 	++lines;
+	++stream.frames;
+	++stream.bank_frames;
 	printf("%d\t%d\t%d\t%d\n", data[0], data[1], data[2], data[3]);
 }
 
@@ -81,7 +136,8 @@ static bool serial_read (void)
 			continue;
 		} else if (e == 2) {
 			e = 0;
-			if (!lines) continue;
+			// in streaming mode, idle characters only separate banks:
+			if (!lines || stream.active) continue;
 			fprintf(stderr, "Break detected, exiting...\n");
 			return false;
 		}
@@ -108,6 +164,7 @@ int main (int argc, const char *argv[])
 
 	// read data from the serial port until a break is detected or the port is closed:
 	while (serial_read()) ;
+	stream_report();
 
 	return 0;
 }
@@ -31,6 +31,7 @@ architecture functional of testbench is
 	signal clk      : std_logic;
 	signal rst      : std_logic;
 	signal irq      : std_logic_vector(0 downto 0) := b"0";
+	signal wakeup   : time_vector(0 downto 0);
 	signal axi      : t_axilite_if(
 		write_address_channel(awaddr(31 downto 0)),
 		write_data_channel(wdata(31 downto 0), wstrb(3 downto 0)),
@@ -41,6 +42,7 @@ begin
 
 	dut : entity PWMtimer
 	port map (
+		clk_wakeup      => wakeup(0),
 		------------------------------------------------------------------------
 		-- AXI slave bus:
 		------------------------------------------------------------------------
@@ -70,7 +72,7 @@ begin
 	);
 
 	cpu : entity CPUemu
-	generic map (fifo_path => "/tmp/test/fifo")
+	generic map (fifo_path => "/tmp/test/fifo", clk_gating => true)
 	port map (
 		M_AXI_ACLK      => clk,
 		M_AXI_ARESETN   => rst,
@@ -93,7 +95,9 @@ begin
 		M_AXI_RRESP     => axi.read_data_channel.rresp,
 		M_AXI_RVALID    => axi.read_data_channel.rvalid,
 		M_AXI_RREADY    => axi.read_data_channel.rready,
-		M_IRQ_LEVEL     => irq
+		M_IRQ_LEVEL     => irq,
+		-- the clock only runs for bus transactions and when the timer needs it:
+		CLK_WAKEUP      => wakeup
 	);
 
 end architecture;
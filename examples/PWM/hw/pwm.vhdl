@@ -12,6 +12,11 @@
 -- 0 : count     (RO) - reads resets IRQ flag
 -- 1 : period    (RW) - counter counts from 0 to period *inclusive*
 -- 2 : PWM value (RW) - set value > period for 100% PWM
+--
+-- The timer also works with a gated clock (see the cosim CLKmgr), that only
+-- runs when needed: "clk_wakeup" tells when the next edge that changes the
+-- IRQ or PWM output is due, and the edges suppressed in between are accounted
+-- for from the time elapsed, assuming they were "clk_period" apart.
 
 library ieee;
 	use ieee.std_logic_1164.all;
@@ -20,10 +25,12 @@ library ieee;
 entity PWMtimer is
 	generic (
 		C_S_AXI_DATA_WIDTH : integer := 32;
-		C_S_AXI_ADDR_WIDTH : integer := 5
+		C_S_AXI_ADDR_WIDTH : integer := 5;
+		clk_period         : time    := 10 ns
 	);
 	port (
 		pwm_out         : out std_logic;
+		clk_wakeup      : out time := time'high;
 		------------------------------------------------------------------------
 		-- AXI subordinate bus:
 		------------------------------------------------------------------------
@@ -214,20 +221,29 @@ begin
 	end process;
 
 	timer : process (S_AXI_ACLK) is
+		variable last  : time := 0 ns;
+		variable count : unsigned(C_S_AXI_DATA_WIDTH-1 downto 0);
+		variable skip  : natural;
 	begin
 		if rising_edge(S_AXI_ACLK) then
 			if tmr_enable = '1' then
+				-- edges suppressed since the previous one just count (see timer_wakeup):
+				skip  := (now - last) / clk_period - 1 when now - last > clk_period else 0;
+				count := tmr_count;
+				if skip > 0 then
+					count := tmr_period when tmr_period - count < skip else count + skip;
+				end if;
 				if tmr_ack then
 					IRQ <= '0';
 				end if;
-				if tmr_count = tmr_period then
+				if count = tmr_period then
 					tmr_pwmact <= tmr_pwmval;
 					tmr_count <= (others => '0');
 					IRQ <= '1';
 				else
-					tmr_count <= tmr_count + 1;
+					tmr_count <= count + 1;
 				end if;
-				if tmr_count < tmr_pwmact then
+				if count < tmr_pwmact then
 					pwm_out <= '1';
 				else
 					pwm_out <= '0';
@@ -238,6 +254,29 @@ begin
 				IRQ <= '0';
 				pwm_out <= '0';
 			end if;
+			last := now;
+		end if;
+	end process;
+
+	timer_wakeup : process (tmr_enable, tmr_count, tmr_period, tmr_pwmact) is
+		-- edges to go until the next one with a visible effect: the one seeing the count
+		-- at period (IRQ), at the PWM value (output low), or at zero (output high):
+		variable edges : unsigned(C_S_AXI_DATA_WIDTH downto 0);
+	begin
+		if tmr_enable = '1' then
+			edges := resize(tmr_period, edges'length) - tmr_count + 1;
+			if tmr_pwmact >= tmr_count and tmr_pwmact - tmr_count + 1 < edges then
+				edges := resize(tmr_pwmact - tmr_count + 1, edges'length);
+			end if;
+			if tmr_count = 0 then
+				edges := to_unsigned(1, edges'length);
+			end if;
+			if edges > 2**30 then
+				edges := to_unsigned(2**30, edges'length); -- just wake up early
+			end if;
+			clk_wakeup <= now + to_integer(edges) * clk_period;
+		else
+			clk_wakeup <= time'high;
 		end if;
 	end process;
 
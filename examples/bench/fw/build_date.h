@@ -0,0 +1,11 @@
+/*
+ * Copyright © 2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ * Department of Information Engineering
+ * Università Politecnica delle Marche (ITALY)
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+extern const char * const build_timestamp_str;
+extern const unsigned int build_timestamp_len;
+
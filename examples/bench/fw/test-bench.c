@@ -0,0 +1,150 @@
+// Cosimulation benchmark suite.
+/*
+ * Copyright © 2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ * Department of Information Engineering
+ * Università Politecnica delle Marche (ITALY)
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "build_date.h"
+#include "platform.h"
+#define BASE_ADDR 0xE0000000
+
+// UART registers:
+#include "fastuart.h"
+
+// Loopback registers:
+typedef struct loop_s
+{
+	      uint32_t scratch[16]; // RW
+	      uint32_t timer;       // RW - cycles before IRQ, 0 disables it
+	      uint32_t status;      // RW - bit 0: IRQ pending, W1C
+	const uint32_t cycles;      // RO
+} loop_t;
+
+// RTL bridge simulation control registers:
+typedef struct sim_s
+{
+	      uint32_t control;     // WO - 0 stops the simulation
+	      uint32_t virt_time;   // RW - virtual time [µs], writing a phase name pointer begins a phase
+	      uint32_t wall_time;   // RW - wall-clock time [µs], writing an operation count ends a phase
+	      uint32_t hdl_time;    // RW - VHDL time [µs], writing an offset switches the functional model there to VHDL
+} sim_t;
+
+static volatile loop_t * const loop = (void *) (BASE_ADDR + 0x1000);
+static volatile sim_t  * const sim  = (void *) (BASE_ADDR + 0x00FFFFF0);
+
+enum loop_events {
+	loop_timer = 4,
+};
+
+// benchmark parameters:
+enum {
+	mmio_ops   = 1000,
+	burst_len  = 16,
+	irq_ops    = 100,
+	irq_delay  = 100,    // VHDL clock cycles before the IRQ fires
+	idle_delay = 100000, // VHDL clock cycles of idle time (1 ms at 100 MHz)
+	uart_bytes = 16384,
+};
+
+static char uart_buffer[uart_bytes];
+
+static void phase_begin (const char *name)
+{
+	sim->virt_time = (uint32_t) name;
+}
+
+static void phase_end (uint32_t ops)
+{
+	sim->wall_time = ops;
+}
+
+void loop_isr (void)
+{
+	loop->status = 1;
+	event_set_nolock(loop_timer);
+}
+
+void generic_isr (void)
+{
+	// both devices share the CPU IRQ line:
+	if (loop->status & 1) loop_isr();
+	uart_isr();
+}
+
+void bench_mmio (void)
+{
+	uint32_t sum = 0;
+
+	phase_begin("mmio_read");
+	for (int i = 0; i < mmio_ops; ++i)
+		sum += loop->scratch[0];
+	phase_end(mmio_ops);
+
+	// writes are fenced by a read, so that each one is a full round trip:
+	phase_begin("mmio_write");
+	for (int i = 0; i < mmio_ops; ++i) {
+		loop->scratch[1] = i;
+		sum += loop->scratch[1];
+	}
+	phase_end(mmio_ops);
+
+	// back-to-back writes, that may be posted, with a single final fence:
+	phase_begin("posted_write");
+	for (int i = 0; i < mmio_ops; ++i)
+		loop->scratch[i % burst_len] = i;
+	sum += loop->scratch[0];
+	phase_end(mmio_ops);
+
+	loop->scratch[15] = sum;
+}
+
+void bench_irq (void)
+{
+	phase_begin("irq_latency");
+	for (int i = 0; i < irq_ops; ++i) {
+		loop->timer = irq_delay;
+		wait_for_event(loop_timer);
+	}
+	phase_end(irq_ops);
+}
+
+void bench_idle (void)
+{
+	phase_begin("idle");
+	loop->timer = idle_delay;
+	wait_for_event(loop_timer);
+	phase_end(1);
+
+	// the same wait, with the firmware polling the pending bit instead of sleeping:
+	phase_begin("idle_poll");
+	disable_interrupts();
+	loop->timer = idle_delay;
+	poll_until(&loop->status, 1, 1);
+	loop->status = 1;
+	enable_interrupts();
+	phase_end(1);
+}
+
+void bench_uart (void)
+{
+	for (int i = 0; i < uart_bytes; ++i)
+		uart_buffer[i] = ' ' + i % 64;
+	phase_begin("uart_tx");
+	uart_post(uart_buffer, uart_bytes);
+	wait_for_event(uart_tx_done);
+	phase_end(uart_bytes);
+}
+
+int main (void)
+{
+	uart_control->tx_fifo.enable = 1;
+
+	bench_mmio();
+	bench_irq();
+	bench_idle();
+	bench_uart();
+	return 0;
+}
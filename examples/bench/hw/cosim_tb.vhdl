@@ -0,0 +1,234 @@
+-- Benchmark testbench for QEMU co-simulation.
+--
+-- Copyright  2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+-- Department of Information Engineering
+-- Universit Politecnica delle Marche (ITALY)
+--
+-- SPDX-License-Identifier: Apache-2.0
+
+
+library ieee;
+	use ieee.std_logic_1164.all;
+	use ieee.numeric_std.all;
+
+library uvvm_util;
+	context uvvm_util.uvvm_util_context;
+
+library bitvis_vip_axilite;
+	use bitvis_vip_axilite.axilite_bfm_pkg.all;
+
+library axi;
+	use axi.all;
+	use axi.axi_lite_pkg.all;
+	use axi.axi_pkg.all;
+
+library common;
+	use common.addr_pkg.all;
+
+library cosim;
+	use cosim.all;
+
+use work.all;
+
+entity testbench is
+	generic (
+		cpu_width : natural := 32  -- CPUemu data width: 64 to run the bench through its wide mode
+	);
+end entity;
+
+architecture functional of testbench is
+	-- CPU interface:
+	signal clk : std_logic;
+	signal rst : std_logic;
+	signal irq_cpu : std_logic_vector(1 downto 0) := b"00";
+	signal axi_cpu : t_axilite_if(
+		write_address_channel(awaddr(31 downto 0)),
+		write_data_channel(wdata(31 downto 0), wstrb(3 downto 0)),
+		read_address_channel(araddr(31 downto 0)),
+		read_data_channel(rdata(31 downto 0))
+	);
+
+	-- CPUemu data lanes, narrowed to the 32-bit interconnect if cpu_width = 64:
+	signal cpu_wdata : std_logic_vector(cpu_width-1   downto 0);
+	signal cpu_wstrb : std_logic_vector(cpu_width/8-1 downto 0);
+	signal cpu_rdata : std_logic_vector(cpu_width-1   downto 0);
+
+	-- Peripheral interfaces:
+	subtype peripherals is integer range 0 to 1;
+	type axi_peripheral_buses_t is array (integer range <>) of t_axilite_if(
+		write_address_channel(awaddr(31 downto 0)),
+		write_data_channel(wdata(31 downto 0), wstrb(3 downto 0)),
+		read_address_channel(araddr(31 downto 0)),
+		read_data_channel(rdata(31 downto 0))
+	);
+	signal axi_peripheral_buses : axi_peripheral_buses_t(peripherals);
+
+	-- AXI xbar:
+	constant peripheral_addrs : addr_and_mask_vec_t(peripherals) := (
+		0 => ( addr => X"00000000", mask => X"FFFFF000" ), -- UART
+		1 => ( addr => X"00001000", mask => X"FFFFF000" )  -- LOOP
+	);
+	signal xbar_outputs_m2s : axi_lite_m2s_vec_t(peripherals);
+	signal xbar_outputs_s2m : axi_lite_s2m_vec_t(peripherals);
+
+	-- UART signals:
+	signal host_rx : std_logic;
+	signal host_tx : std_logic;
+
+begin
+
+	xbar : entity axi_lite_mux
+	generic map (slave_addrs => peripheral_addrs)
+	port map (
+		clk => clk,
+		-- xbar port to manager interface (CPU):
+		axi_lite_m2s.write.aw.addr   => unsigned(axi_cpu.write_address_channel.awaddr),
+		axi_lite_m2s.write.aw.valid  => axi_cpu.write_address_channel.awvalid,
+		axi_lite_m2s.write.w.data    => axi_cpu.write_data_channel.wdata,
+		axi_lite_m2s.write.w.strb    => axi_cpu.write_data_channel.wstrb,
+		axi_lite_m2s.write.w.valid   => axi_cpu.write_data_channel.wvalid,
+		axi_lite_m2s.write.b.ready   => axi_cpu.write_response_channel.bready,
+		axi_lite_m2s.read.ar.addr    => unsigned(axi_cpu.read_address_channel.araddr),
+		axi_lite_m2s.read.ar.valid   => axi_cpu.read_address_channel.arvalid,
+		axi_lite_m2s.read.r.ready    => axi_cpu.read_data_channel.rready,
+		axi_lite_s2m.write.aw.ready  => axi_cpu.write_address_channel.awready,
+		axi_lite_s2m.write.w.ready   => axi_cpu.write_data_channel.wready,
+		axi_lite_s2m.write.b.resp    => axi_cpu.write_response_channel.bresp,
+		axi_lite_s2m.write.b.valid   => axi_cpu.write_response_channel.bvalid,
+		axi_lite_s2m.read.ar.ready   => axi_cpu.read_address_channel.arready,
+		axi_lite_s2m.read.r.data     => axi_cpu.read_data_channel.rdata,
+		axi_lite_s2m.read.r.resp     => axi_cpu.read_data_channel.rresp,
+		axi_lite_s2m.read.r.valid    => axi_cpu.read_data_channel.rvalid,
+		-- xbar ports to subordinate interfaces:
+		axi_lite_m2s_vec => xbar_outputs_m2s,
+		axi_lite_s2m_vec => xbar_outputs_s2m
+	);
+
+	subs : for x in peripherals generate
+		axi_peripheral_buses(x).write_address_channel.awaddr  <= std_ulogic_vector(xbar_outputs_m2s(x).write.aw.addr);
+		axi_peripheral_buses(x).write_address_channel.awvalid <= xbar_outputs_m2s(x).write.aw.valid  ;
+		axi_peripheral_buses(x).write_data_channel.wdata      <= xbar_outputs_m2s(x).write.w.data    ;
+		axi_peripheral_buses(x).write_data_channel.wstrb      <= xbar_outputs_m2s(x).write.w.strb    ;
+		axi_peripheral_buses(x).write_data_channel.wvalid     <= xbar_outputs_m2s(x).write.w.valid   ;
+		axi_peripheral_buses(x).write_response_channel.bready <= xbar_outputs_m2s(x).write.b.ready   ;
+		axi_peripheral_buses(x).read_address_channel.araddr   <= std_ulogic_vector(xbar_outputs_m2s(x).read.ar.addr);
+		axi_peripheral_buses(x).read_address_channel.arvalid  <= xbar_outputs_m2s(x).read.ar.valid   ;
+		axi_peripheral_buses(x).read_data_channel.rready      <= xbar_outputs_m2s(x).read.r.ready    ;
+		xbar_outputs_s2m(x).write.aw.ready  <= axi_peripheral_buses(x).write_address_channel.awready ;
+		xbar_outputs_s2m(x).write.w.ready   <= axi_peripheral_buses(x).write_data_channel.wready     ;
+		xbar_outputs_s2m(x).write.b.resp    <= axi_peripheral_buses(x).write_response_channel.bresp  ;
+		xbar_outputs_s2m(x).write.b.valid   <= axi_peripheral_buses(x).write_response_channel.bvalid ;
+		xbar_outputs_s2m(x).read.ar.ready   <= axi_peripheral_buses(x).read_address_channel.arready  ;
+		xbar_outputs_s2m(x).read.r.data     <= axi_peripheral_buses(x).read_data_channel.rdata       ;
+		xbar_outputs_s2m(x).read.r.resp     <= axi_peripheral_buses(x).read_data_channel.rresp       ;
+		xbar_outputs_s2m(x).read.r.valid    <= axi_peripheral_buses(x).read_data_channel.rvalid      ;
+	end generate;
+
+	dev_uart : entity UART_interface
+	port map (
+		------------------------------------------------------------------------
+		-- AXI subordinate bus:
+		------------------------------------------------------------------------
+		S_AXI_ACLK      => clk,
+		S_AXI_ARESETN   => rst,
+		S_AXI_AWADDR    => axi_peripheral_buses(0).write_address_channel.awaddr(4 downto 0),
+		S_AXI_AWPROT    => axi_peripheral_buses(0).write_address_channel.awprot,
+		S_AXI_AWVALID   => axi_peripheral_buses(0).write_address_channel.awvalid,
+		S_AXI_AWREADY   => axi_peripheral_buses(0).write_address_channel.awready,
+		S_AXI_WDATA     => axi_peripheral_buses(0).write_data_channel.wdata,
+		S_AXI_WSTRB     => axi_peripheral_buses(0).write_data_channel.wstrb,
+		S_AXI_WVALID    => axi_peripheral_buses(0).write_data_channel.wvalid,
+		S_AXI_WREADY    => axi_peripheral_buses(0).write_data_channel.wready,
+		S_AXI_BRESP     => axi_peripheral_buses(0).write_response_channel.bresp,
+		S_AXI_BVALID    => axi_peripheral_buses(0).write_response_channel.bvalid,
+		S_AXI_BREADY    => axi_peripheral_buses(0).write_response_channel.bready,
+		S_AXI_ARADDR    => axi_peripheral_buses(0).read_address_channel.araddr(4 downto 0),
+		S_AXI_ARPROT    => axi_peripheral_buses(0).read_address_channel.arprot,
+		S_AXI_ARVALID   => axi_peripheral_buses(0).read_address_channel.arvalid,
+		S_AXI_ARREADY   => axi_peripheral_buses(0).read_address_channel.arready,
+		S_AXI_RDATA     => axi_peripheral_buses(0).read_data_channel.rdata,
+		S_AXI_RRESP     => axi_peripheral_buses(0).read_data_channel.rresp,
+		S_AXI_RVALID    => axi_peripheral_buses(0).read_data_channel.rvalid,
+		S_AXI_RREADY    => axi_peripheral_buses(0).read_data_channel.rready,
+		------------------------------------------------------------------------
+		uart_tx         => host_rx,
+		uart_rx         => host_tx,
+		irq             => irq_cpu(0)
+	);
+
+	dev_loop : entity loopback_regs
+	port map (
+		------------------------------------------------------------------------
+		-- AXI subordinate bus:
+		------------------------------------------------------------------------
+		S_AXI_ACLK      => clk,
+		S_AXI_ARESETN   => rst,
+		S_AXI_AWADDR    => axi_peripheral_buses(1).write_address_channel.awaddr(6 downto 0),
+		S_AXI_AWPROT    => axi_peripheral_buses(1).write_address_channel.awprot,
+		S_AXI_AWVALID   => axi_peripheral_buses(1).write_address_channel.awvalid,
+		S_AXI_AWREADY   => axi_peripheral_buses(1).write_address_channel.awready,
+		S_AXI_WDATA     => axi_peripheral_buses(1).write_data_channel.wdata,
+		S_AXI_WSTRB     => axi_peripheral_buses(1).write_data_channel.wstrb,
+		S_AXI_WVALID    => axi_peripheral_buses(1).write_data_channel.wvalid,
+		S_AXI_WREADY    => axi_peripheral_buses(1).write_data_channel.wready,
+		S_AXI_BRESP     => axi_peripheral_buses(1).write_response_channel.bresp,
+		S_AXI_BVALID    => axi_peripheral_buses(1).write_response_channel.bvalid,
+		S_AXI_BREADY    => axi_peripheral_buses(1).write_response_channel.bready,
+		S_AXI_ARADDR    => axi_peripheral_buses(1).read_address_channel.araddr(6 downto 0),
+		S_AXI_ARPROT    => axi_peripheral_buses(1).read_address_channel.arprot,
+		S_AXI_ARVALID   => axi_peripheral_buses(1).read_address_channel.arvalid,
+		S_AXI_ARREADY   => axi_peripheral_buses(1).read_address_channel.arready,
+		S_AXI_RDATA     => axi_peripheral_buses(1).read_data_channel.rdata,
+		S_AXI_RRESP     => axi_peripheral_buses(1).read_data_channel.rresp,
+		S_AXI_RVALID    => axi_peripheral_buses(1).read_data_channel.rvalid,
+		S_AXI_RREADY    => axi_peripheral_buses(1).read_data_channel.rready,
+		------------------------------------------------------------------------
+		IRQ             => irq_cpu(1)
+	);
+
+	-- 32-bit accesses of a 64-bit CPUemu use the byte lanes selected by address bit 2:
+	lanes : if cpu_width = 64 generate
+		axi_cpu.write_data_channel.wdata <= cpu_wdata(63 downto 32) when axi_cpu.write_address_channel.awaddr(2) = '1' else cpu_wdata(31 downto 0);
+		axi_cpu.write_data_channel.wstrb <= cpu_wstrb( 7 downto  4) when axi_cpu.write_address_channel.awaddr(2) = '1' else cpu_wstrb( 3 downto 0);
+		cpu_rdata <= axi_cpu.read_data_channel.rdata & axi_cpu.read_data_channel.rdata;
+	else generate
+		axi_cpu.write_data_channel.wdata <= cpu_wdata;
+		axi_cpu.write_data_channel.wstrb <= cpu_wstrb;
+		cpu_rdata <= axi_cpu.read_data_channel.rdata;
+	end generate;
+
+	cpu : entity CPUemu
+	generic map (fifo_path => "/tmp/test/fifo", data_width => cpu_width)
+	port map (
+		M_AXI_ACLK      => clk,
+		M_AXI_ARESETN   => rst,
+		M_AXI_AWADDR    => axi_cpu.write_address_channel.awaddr,
+		M_AXI_AWPROT    => axi_cpu.write_address_channel.awprot,
+		M_AXI_AWVALID   => axi_cpu.write_address_channel.awvalid,
+		M_AXI_AWREADY   => axi_cpu.write_address_channel.awready,
+		M_AXI_WDATA     => cpu_wdata,
+		M_AXI_WSTRB     => cpu_wstrb,
+		M_AXI_WVALID    => axi_cpu.write_data_channel.wvalid,
+		M_AXI_WREADY    => axi_cpu.write_data_channel.wready,
+		M_AXI_BRESP     => axi_cpu.write_response_channel.bresp,
+		M_AXI_BVALID    => axi_cpu.write_response_channel.bvalid,
+		M_AXI_BREADY    => axi_cpu.write_response_channel.bready,
+		M_AXI_ARADDR    => axi_cpu.read_address_channel.araddr,
+		M_AXI_ARPROT    => axi_cpu.read_address_channel.arprot,
+		M_AXI_ARVALID   => axi_cpu.read_address_channel.arvalid,
+		M_AXI_ARREADY   => axi_cpu.read_address_channel.arready,
+		M_AXI_RDATA     => cpu_rdata,
+		M_AXI_RRESP     => axi_cpu.read_data_channel.rresp,
+		M_AXI_RVALID    => axi_cpu.read_data_channel.rvalid,
+		M_AXI_RREADY    => axi_cpu.read_data_channel.rready,
+		M_IRQ_LEVEL     => irq_cpu
+	);
+
+	pty : entity PTYemu
+	generic map (pty_path => "/tmp/test/pty")
+	port map (
+		rx => host_rx,
+		tx => host_tx
+	);
+
+end architecture;
@@ -0,0 +1,150 @@
+// Cosimulation benchmark suite: results comparison.
+/*
+ * Copyright © 2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ * Department of Information Engineering
+ * Università Politecnica delle Marche (ITALY)
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+// one line of the JSON file written by the RTL bridge "bench" option:
+typedef struct {
+	char    phase[32];
+	double  ops;
+	double  wall_ns;
+	double  virt_ns;
+	double  hdl_us;
+	double  irqs;
+	double  irq_wall_ns;
+	double  irq_virt_ns;
+} result_t;
+
+enum { max_results = 64 };
+
+typedef struct {
+	result_t item[max_results];
+	int      count;
+} results_t;
+
+static double json_number (const char *line, const char *key)
+{
+	char pattern[40];
+	snprintf(pattern, sizeof pattern, "\"%s\":", key);
+	const char *p = strstr(line, pattern);
+	return p ? strtod(p + strlen(pattern), NULL) : 0;
+}
+
+static void json_string (const char *line, const char *key, char *value, size_t size)
+{
+	char pattern[40];
+	snprintf(pattern, sizeof pattern, "\"%s\":\"", key);
+	const char *p = strstr(line, pattern);
+	size_t n = 0;
+	if (p) {
+		p += strlen(pattern);
+		while (p[n] && p[n] != '"' && n < size - 1) ++n;
+		memcpy(value, p, n);
+	}
+	value[n] = '\0';
+}
+
+static bool load (const char *filename, results_t *r)
+{
+	FILE *f = fopen(filename, "r");
+	if (!f) {
+		perror(filename);
+		return false;
+	}
+	char line[1024];
+	r->count = 0;
+	while (fgets(line, sizeof line, f) && r->count < max_results) {
+		result_t *x = &r->item[r->count];
+		json_string(line, "phase", x->phase, sizeof x->phase);
+		if (!*x->phase) continue;
+		x->ops         = json_number(line, "ops");
+		x->wall_ns     = json_number(line, "wall_ns");
+		x->virt_ns     = json_number(line, "virt_ns");
+		x->hdl_us      = json_number(line, "hdl_us");
+		x->irqs        = json_number(line, "irqs");
+		x->irq_wall_ns = json_number(line, "irq_wall_ns");
+		x->irq_virt_ns = json_number(line, "irq_virt_ns");
+		if (x->ops < 1) x->ops = 1;
+		++r->count;
+	}
+	fclose(f);
+	return true;
+}
+
+// derived metrics, all of them "lower is better":
+typedef struct {
+	const char *name;
+	const char *unit;
+	double    (*value)(const result_t *);
+} metric_t;
+
+static double wall_per_op (const result_t *x) { return x->wall_ns / x->ops; }
+static double virt_per_op (const result_t *x) { return x->virt_ns / x->ops; }
+static double irq_wall    (const result_t *x) { return x->irqs ? x->irq_wall_ns / x->irqs : 0; }
+static double irq_virt    (const result_t *x) { return x->irqs ? x->irq_virt_ns / x->irqs : 0; }
+static double wall_per_s  (const result_t *x) { return x->hdl_us ? x->wall_ns / x->hdl_us * 1e-3 : 0; }
+
+static const metric_t metrics[] = {
+	{"wall/op",     "ns",      wall_per_op},
+	{"virt/op",     "ns",      virt_per_op},
+	{"irq wall",    "ns",      irq_wall},
+	{"irq virt",    "ns",      irq_virt},
+	{"wall/VHDL s", "s",       wall_per_s},
+};
+
+static const result_t *find (const results_t *r, const char *phase)
+{
+	for (int i = 0; i < r->count; ++i)
+		if (!strcmp(r->item[i].phase, phase)) return &r->item[i];
+	return NULL;
+}
+
+int main (int argc, char *argv[])
+{
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "Usage: %s [baseline.json] results.json [threshold %%]\n", argv[0]);
+		return 2;
+	}
+	static results_t base, test;
+	bool compare = argc > 2;
+	double threshold = argc > 3 ? atof(argv[3]) : 10.0;
+	if (!load(argv[compare ? 2 : 1], &test)) return 2;
+	if (compare && !load(argv[1], &base)) return 2;
+
+	int regressions = 0;
+	printf("%-14s %-12s %14s", "phase", "metric", "result");
+	if (compare) printf(" %14s %9s", "baseline", "change");
+	printf("\n");
+	for (int i = 0; i < test.count; ++i) {
+		const result_t *x = &test.item[i];
+		const result_t *y = compare ? find(&base, x->phase) : NULL;
+		for (int m = 0; m < sizeof metrics / sizeof *metrics; ++m) {
+			double v = metrics[m].value(x);
+			if (v == 0) continue;
+			printf("%-14s %-12s %11.1f %-2s", x->phase, metrics[m].name, v, metrics[m].unit);
+			if (y) {
+				double w = metrics[m].value(y);
+				if (w != 0) {
+					double change = (v - w) / w * 100;
+					bool worse = change > threshold;
+					printf(" %11.1f %-2s %+8.1f%%%s", w, metrics[m].unit, change, worse ? "  <-- REGRESSION" : "");
+					regressions += worse;
+				}
+			}
+			printf("\n");
+		}
+	}
+	if (compare) printf("%d regression(s) above %.1f%%\n", regressions, threshold);
+	return regressions ? 1 : 0;
+}
@@ -0,0 +1,323 @@
+// Cosimulation benchmark suite: mock VHDL peer.
+/*
+ * Copyright © 2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ * Department of Information Engineering
+ * Università Politecnica delle Marche (ITALY)
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Speaks the CPUemu protocol over the same link code (ghdl/files/CPUemu.c),
+// backing the bus with a plain 64 KiB register file instead of an RTL design,
+// so that the cost of QEMU and of the transport can be measured in isolation.
+// The loopback timer and a minimal always-ready UART of the bench testbench
+// are emulated as well, so that the bench firmware runs unmodified.
+
+#define _DEFAULT_SOURCE
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+
+
+// link layer, from CPUemu.c:
+
+typedef struct {
+	int32_t  left;
+	int32_t  right;
+	int32_t  dir;
+	int32_t  len;
+} range_t;
+
+typedef struct {
+	void    *data;
+	range_t *bounds;
+} array_t;
+
+extern void cpu_link_open (const array_t *path);
+extern int  cpu_link_recv (int timeout);
+extern void cpu_link_send (const array_t *data);
+
+static void link_open (const char *path)
+{
+	range_t r = {.len = strlen(path)};
+	array_t a = {.data = (void *) path, .bounds = &r};
+	cpu_link_open(&a);
+}
+
+static void link_send (const char *fmt, uint32_t value)
+{
+	char buffer[16];
+	snprintf(buffer, sizeof buffer, fmt, value);
+	range_t r = {.len = 12};
+	array_t a = {.data = buffer, .bounds = &r};
+	cpu_link_send(&a);
+}
+
+static int link_line (char *line, int size)
+{
+	int len = 0, c;
+	while ((c = cpu_link_recv(-1)) >= 0 && c != '\n') {
+		if (c != '\r' && len < size - 1) line[len++] = c;
+	}
+	line[len] = '\0';
+	return c < 0 ? -1 : len;
+}
+
+
+// simulated time and peripherals:
+
+static uint64_t clk_period = 10;    // bus clock period [ns]
+static uint64_t bus_cycles = 4;     // clock cycles per bus transaction
+static uint64_t period;             // periodic IRQ [ns], 0 = disabled
+static bool     verbose;
+
+static uint64_t now;                // current time [ns]
+static uint32_t irq, irq_sent;      // IRQ lines, as sent to QEMU
+static uint32_t regs[0x10000 / 4];  // register file
+static uint32_t snap_addr[8];       // registers sent along with each new IRQ ("S:" commands)
+static unsigned snap_count;
+
+enum {
+	uart_data    = 0x0000 / 4,
+	uart_control = 0x0004 / 4,
+	loop_timer   = 0x1040 / 4,
+	loop_status  = 0x1044 / 4,
+	loop_cycles  = 0x1048 / 4,
+};
+
+static uint64_t timer_deadline;     // absolute time of loopback timer expiry, 0 = disabled
+static uint64_t period_deadline;
+static FILE    *script;             // "time[µs] irq-mask[hex]" lines, in increasing time order
+static uint64_t script_time;
+static uint32_t script_irq;
+static bool     script_next;
+
+static void script_load (void)
+{
+	unsigned long long t;
+	unsigned mask;
+	script_next = script && fscanf(script, "%llu %x", &t, &mask) == 2;
+	script_time = t * 1000;
+	script_irq  = mask;
+}
+
+static uint32_t reg_value (uint32_t addr);
+
+static void update_irq (void)
+{
+	// UART: only "TX empty" and "TX half" can fire, as its FIFO is always empty:
+	uint8_t enables = regs[uart_control] >> 24;
+	bool uart_irq = enables & 0x0C;
+	irq = (irq & ~3u) | uart_irq << 0 | (regs[loop_status] & 1) << 1;
+	if (irq != irq_sent) {
+		// snapshot reads are taken as free, in this bus model:
+		if (irq & ~irq_sent) {
+			for (unsigned i = 0; i < snap_count; ++i) link_send("V=%08X\r\n", reg_value(snap_addr[i]));
+		}
+		irq_sent = irq;
+		link_send("I=%08X\r\n", irq);
+	}
+}
+
+static uint64_t next_event (void)
+{
+	uint64_t t = UINT64_MAX;
+	if (timer_deadline && timer_deadline < t) t = timer_deadline;
+	if (period && period_deadline < t) t = period_deadline;
+	if (script_next && script_time < t) t = script_time;
+	return t;
+}
+
+static void advance (uint64_t target, bool stop_on_irq)
+{
+	// move time forward, firing the scheduled events on the way:
+	while (true) {
+		uint64_t t = next_event();
+		if (t > target) break;
+		now = t;
+		if (timer_deadline && timer_deadline <= now) {
+			timer_deadline = 0;
+			regs[loop_status] |= 1;
+		}
+		if (period && period_deadline <= now) {
+			period_deadline += period;
+			regs[loop_status] |= 1;
+		}
+		if (script_next && script_time <= now) {
+			irq = (irq & 3u) | (script_irq & ~3u);
+			script_load();
+		}
+		uint32_t old = irq_sent;
+		update_irq();
+		if (stop_on_irq && irq_sent != old) return;
+	}
+	if (target > now) now = target;
+}
+
+static uint32_t reg_value (uint32_t addr)
+{
+	uint32_t reg = (addr & 0xFFFF) / 4;
+	switch (reg) {
+		case uart_data:    return 0x119; // RX FIFO empty
+		case uart_control: return (regs[reg] & 0xFFFF0000) | 0x0103; // TX empty and half, RX empty
+		case loop_timer:   return timer_deadline > now ? (timer_deadline - now) / clk_period : 0;
+		case loop_cycles:  return now / clk_period;
+	}
+	return regs[reg];
+}
+
+static uint32_t bus_read (uint32_t addr)
+{
+	advance(now + bus_cycles * clk_period, false);
+	return reg_value(addr);
+}
+
+static void bus_write (uint32_t addr, uint32_t data, uint32_t mask)
+{
+	uint32_t reg = (addr & 0xFFFF) / 4;
+	uint32_t bits = 0;
+	for (int i = 0; i < 4; ++i)
+		if (mask & 1 << i) bits |= 0xFFu << 8 * i;
+	advance(now + bus_cycles * clk_period, false);
+	switch (reg) {
+		case uart_data:
+			return; // characters just vanish
+		case loop_timer:
+			timer_deadline = data ? now + data * clk_period : 0;
+			return;
+		case loop_status:
+			if (mask & 1 && data & 1) regs[reg] &= ~1u;
+			break;
+		default:
+			regs[reg] = (regs[reg] & ~bits) | (data & bits);
+	}
+	update_irq();
+}
+
+static void sync_to (const char *stamp)
+{
+	// optional "@TTTTTTTT" VHDL time of the transaction [µs], as in CPUemu:
+	unsigned t;
+	if (stamp && sscanf(stamp, "@%X", &t) == 1 && t * 1000ull > now)
+		advance(t * 1000ull, false);
+}
+
+
+int main (int argc, char *argv[])
+{
+	const char *link = "/tmp/test/fifo";
+	static const struct option options[] = {
+		{"link",    required_argument, NULL, 'l'},
+		{"clk",     required_argument, NULL, 'c'},
+		{"cycles",  required_argument, NULL, 'b'},
+		{"period",  required_argument, NULL, 'p'},
+		{"script",  required_argument, NULL, 's'},
+		{"verbose", no_argument,       NULL, 'v'},
+		{NULL, 0, NULL, 0}
+	};
+	for (int opt; (opt = getopt_long(argc, argv, "l:c:b:p:s:v", options, NULL)) != -1; ) {
+		switch (opt) {
+			case 'l': link       = optarg; break;
+			case 'c': clk_period = strtoull(optarg, NULL, 0); break;
+			case 'b': bus_cycles = strtoull(optarg, NULL, 0); break;
+			case 'p': period     = strtoull(optarg, NULL, 0) * 1000; break;
+			case 's':
+				script = fopen(optarg, "r");
+				if (!script) {
+					perror(optarg);
+					return 1;
+				}
+				break;
+			case 'v': verbose    = true; break;
+			default:
+				fprintf(stderr, "Usage: %s [--link=PATH] [--clk=NS] [--cycles=N] [--period=US] [--script=FILE] [--verbose]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (!clk_period) clk_period = 1;
+	period_deadline = period;
+	script_load();
+	link_open(link); // COSIM_LINK overrides it, as with GHDL
+
+	char line[64];
+	unsigned addr, mask, t;
+	unsigned long long data;
+	for (int len; (len = link_line(line, sizeof line)) >= 0; ) {
+		if (!len) continue;
+		if (verbose) printf("%12llu ns: %s\n", (unsigned long long) now, line);
+		switch (line[0]) {
+			case 'R':
+				if (sscanf(line, "R:%X", &addr) != 1) break;
+				sync_to(strchr(line, '@'));
+				if (strchr(line, '/')) {
+					// 64-bit read ("/8"), upper word first:
+					link_send("D=%08X\r\n", bus_read((addr & ~7u) + 4));
+					addr &= ~7u;
+				}
+				link_send("R=%08X\r\n", bus_read(addr));
+				continue;
+			case 'W':
+				if (sscanf(line, "W:%X<=%llX|%X", &addr, &data, &mask) != 3) break;
+				sync_to(strchr(line, '@'));
+				if (strcspn(line, "|") > 12 + 8) {
+					// 64-bit write, as two words:
+					if (mask & 0x0F) bus_write( addr & ~7u,      data,       mask & 0xF);
+					if (mask & 0xF0) bus_write((addr & ~7u) + 4, data >> 32, mask >> 4);
+				} else {
+					bus_write(addr, data, mask);
+				}
+				link_send("W=OK      \r\n", 0);
+				continue;
+			case 'P': {
+				// polling loop: read until the condition holds, an IRQ changes, or time runs out:
+				unsigned value, want;
+				char op;
+				if (sscanf(line, "P:%X&%X%c=%X~%X", &addr, &mask, &op, &want, &t) != 5) break;
+				uint64_t start = now;
+				uint32_t irq0 = irq_sent;
+				do {
+					value = bus_read(addr);
+				} while (((value & mask) == want) != (op == '=') && irq_sent == irq0 && now - start < t * 1000ull);
+				link_send("P=%08X\r\n", (now - start) / 1000);
+				link_send("R=%08X\r\n", value);
+				continue;
+			}
+			case 'T':
+				if (sscanf(line, "T:%X", &t) != 1) break;
+				advance(now + t * 1000ull, true);
+				link_send("T=%08X\r\n", now / 1000);
+				continue;
+			case 'Q':
+				// loosely-timed grant: there is no point in running ahead here.
+				if (sscanf(line, "Q:%X", &t) != 1) break;
+				if (t * 1000ull > now) advance(t * 1000ull, false);
+				link_send("Q=%08X\r\n", now / 1000);
+				continue;
+			case 'S':
+				if (sscanf(line, "S:%X", &addr) != 1 || snap_count == 8) break;
+				snap_addr[snap_count++] = addr;
+				continue;
+			case 'X':
+				if (!strncmp(line, "X:RESET", 7)) {
+					link_send("X=RESET   \r\n", 0);
+					snap_count = 0;
+					memset(regs, 0, sizeof regs);
+					timer_deadline = 0;
+					irq &= ~3u;
+					advance(now + 20 * clk_period, false);
+					update_irq();
+					link_send("X=RUNNING \r\n", 0);
+					continue;
+				}
+				if (!strncmp(line, "X:STOP", 6)) return 0;
+				break;
+		}
+		fprintf(stderr, "mock-peer: unknown command '%s'\n", line);
+		return 1;
+	}
+	return 0;
+}
@@ -10,6 +10,18 @@
 #include <stdbool.h>
 
 static volatile uint32_t * const simulator_stop = (void *) (0xE0000000 + 0x00FFFFF0);
+static volatile uint32_t * const simulator_poll = (void *) (0xE0000000 + 0x00FFFFE0); // mask, ==value, !=value
+
+// Busy-wait until (*reg & mask) == value. Under the RTL bridge the whole loop is
+// run by VHDL, until the condition holds or an IRQ comes; any other write ends it.
+__inline static uint32_t poll_until (volatile uint32_t *reg, uint32_t mask, uint32_t value)
+{
+	uint32_t v;
+	simulator_poll[0] = mask;
+	simulator_poll[1] = value;
+	while (((v = *reg) & mask) != value);
+	return v;
+}
 
 __inline static void enable_interrupts (void)
 {
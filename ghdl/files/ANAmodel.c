@@ -0,0 +1,228 @@
+/*
+ * GHDL VHPIDIRECT analog block library for mixed-signal testbenches
+ * (developed for and tested with GHDL v3.0)
+ *
+ * Author:
+ *      Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *      Department of Information Engineering
+ *      Università Politecnica delle Marche (ITALY)
+ *
+ * Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// An analog model is a chain of blocks (integrator, gain, biquad, FIR, delay)
+// evaluated in C for up to four channels at once, one SIMD lane per channel.
+// VHDL only reports input level changes, with their time stamps, and asks
+// for a new sample at each ADC strobe: nothing is evaluated in between, so
+// the cost no longer depends on the simulation clock (see ANAmodel.vhdl).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#define VERBOSE false
+
+typedef double v4d __attribute__ ((vector_size (4 * sizeof (double))));
+
+enum { lanes = 4, max_models = 16, max_blocks = 16 };
+
+
+// data types used to interface with GHDL arrays:
+
+typedef struct {
+	int32_t  left;
+	int32_t  right;
+	int32_t  dir;
+	int32_t  len;
+} range_t;
+
+typedef struct {
+	void    *data;
+	range_t *bounds;
+} array_t;
+
+typedef enum { block_integrator, block_gain, block_biquad, block_fir, block_delay } block_type_t;
+
+typedef struct {
+	block_type_t type;
+	double       k[5];      // gain, or biquad b0, b1, b2, a1, a2 (with a0 = 1)
+	v4d          w[2];      // biquad state (direct form II)
+	double      *taps;      // FIR coefficients
+	v4d         *line;      // FIR or delay line
+	int          length;
+	int          pos;
+} block_t;
+
+typedef struct {
+	int          channels;
+	int64_t      clk_period;    // integrator time unit [fs]
+	block_t      block[max_blocks];
+	int          blocks;
+	// integrator input, held between level changes:
+	v4d          level;
+	v4d          area;          // integral of level since last sample
+	int64_t      since;         // time of last level change or sample [fs]
+	v4d          output;
+} model_t;
+
+static model_t *models[max_models];
+static int      count;
+
+static model_t *model_get (int32_t h)
+{
+	if (h < 0 || h >= count) {
+		fprintf(stderr, "ANAmodel: bad handle %d\n", h);
+		exit(1);
+	}
+	return models[h];
+}
+
+static block_t *block_add (int32_t h, block_type_t type)
+{
+	model_t *m = model_get(h);
+	if (m->blocks == max_blocks) {
+		fprintf(stderr, "ANAmodel: too many blocks\n");
+		exit(1);
+	}
+	block_t *b = &m->block[m->blocks++];
+	b->type = type;
+	return b;
+}
+
+static void integrate (model_t *m, int64_t t)
+{
+	if (t > m->since) m->area += m->level * ((double) (t - m->since) / m->clk_period);
+	m->since = t;
+}
+
+
+// VHDL interface:
+
+int ana_create (int32_t channels, int64_t clk_period)
+{
+	if (count == max_models || channels < 1 || channels > lanes || clk_period <= 0) {
+		fprintf(stderr, "ANAmodel: cannot create model with %d channels\n", channels);
+		exit(1);
+	}
+	model_t *m = calloc(1, sizeof *m);
+	if (!m) exit(1);
+	m->channels   = channels;
+	m->clk_period = clk_period;
+	models[count] = m;
+	return count++;
+}
+
+void ana_integrator (int32_t h, double gain)
+{
+	// input levels integrated over time, in units of the clock period:
+	block_t *b = block_add(h, block_integrator);
+	b->k[0] = gain;
+}
+
+void ana_gain (int32_t h, double gain)
+{
+	block_t *b = block_add(h, block_gain);
+	b->k[0] = gain;
+}
+
+void ana_biquad (int32_t h, double b0, double b1, double b2, double a1, double a2)
+{
+	block_t *b = block_add(h, block_biquad);
+	b->k[0] = b0;
+	b->k[1] = b1;
+	b->k[2] = b2;
+	b->k[3] = a1;
+	b->k[4] = a2;
+}
+
+void ana_fir (int32_t h, const array_t *coeffs)
+{
+	block_t *b = block_add(h, block_fir);
+	b->length = coeffs->bounds->len;
+	b->taps   = malloc(b->length * sizeof *b->taps);
+	b->line   = calloc(b->length, sizeof *b->line);
+	if (!b->taps || !b->line) exit(1);
+	memcpy(b->taps, coeffs->data, b->length * sizeof *b->taps);
+}
+
+void ana_delay (int32_t h, int32_t samples)
+{
+	block_t *b = block_add(h, block_delay);
+	b->length = samples > 0 ? samples : 1;
+	b->line   = calloc(b->length, sizeof *b->line);
+	if (!b->line) exit(1);
+}
+
+void ana_input (int32_t h, int32_t ch, double level, int64_t t)
+{
+	model_t *m = model_get(h);
+	if (ch < 0 || ch >= m->channels) return;
+	integrate(m, t);
+	m->level[ch] = level;
+}
+
+void ana_sample (int32_t h, int64_t t)
+{
+	// evaluate one sample of all channels through the whole chain:
+	model_t *m = model_get(h);
+	v4d x = m->level;
+	for (int i = 0; i < m->blocks; ++i) {
+		block_t *b = &m->block[i];
+		switch (b->type) {
+			case block_integrator:
+				integrate(m, t);
+				x = m->area * b->k[0];
+				m->area = (v4d) {0};
+				break;
+			case block_gain:
+				x *= b->k[0];
+				break;
+			case block_biquad: {
+				v4d w = x - b->k[3] * b->w[0] - b->k[4] * b->w[1];
+				x = b->k[0] * w + b->k[1] * b->w[0] + b->k[2] * b->w[1];
+				b->w[1] = b->w[0];
+				b->w[0] = w;
+				break;
+			}
+			case block_fir: {
+				b->line[b->pos] = x;
+				v4d y = {0};
+				for (int j = 0, p = b->pos; j < b->length; ++j, p = p ? p - 1 : b->length - 1)
+					y += b->taps[j] * b->line[p];
+				b->pos = (b->pos + 1) % b->length;
+				x = y;
+				break;
+			}
+			case block_delay: {
+				v4d y = b->line[b->pos];
+				b->line[b->pos] = x;
+				b->pos = (b->pos + 1) % b->length;
+				x = y;
+				break;
+			}
+		}
+	}
+	m->output = x;
+	if (VERBOSE) printf("ANAmodel %d: %g %g %g %g\n", h, x[0], x[1], x[2], x[3]);
+}
+
+double ana_output (int32_t h, int32_t ch)
+{
+	model_t *m = model_get(h);
+	return ch >= 0 && ch < m->channels ? m->output[ch] : 0.0;
+}
+
+int ana_adc (int32_t h, int32_t ch, double scale, int32_t bits)
+{
+	// ADC quantizer: round to nearest, saturating to a signed "bits"-bit range:
+	double limit = ldexp(1.0, (bits < 2 ? 2 : bits > 32 ? 32 : bits) - 1);
+	double v = round(ana_output(h, ch) * scale);
+	if (v >  limit - 1) v =  limit - 1;
+	if (v < -limit)     v = -limit;
+	return (int) v;
+}
@@ -0,0 +1,118 @@
+-- Analog block library for mixed-signal co-simulation testbenches.
+--
+-- Copyright  2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+-- Department of Information Engineering
+-- Universit Politecnica delle Marche (ITALY)
+--
+-- SPDX-License-Identifier: Apache-2.0
+
+-- Analog models are chains of blocks evaluated in C (ANAmodel.c), for up to
+-- four channels each. Their inputs are only updated on level changes, and a
+-- new output sample is only computed at each ADC strobe, e.g.:
+--
+--	constant model : integer := ana_create(1, clk_period);
+--	...
+--	ana_integrator(model, 1.0E-3);
+--	ana_biquad(model, b0, b1, b2, a1, a2);
+--	...
+--	ana_input(model, 0, +1.0);           -- on each input edge
+--	ana_sample(model);                   -- on each ADC strobe
+--	data <= ana_adc(model, 0, 2.0**20, 32);
+
+
+package ANAmodel is
+
+	-- new model with the given number of channels (1 to 4), where "clk_period"
+	-- is the time unit used by the integrators:
+	impure function ana_create (channels : integer; clk_period : time) return integer;
+	attribute foreign of ana_create : function is "VHPIDIRECT ana_create";
+
+	-- blocks, applied to all channels in the order they are added:
+	procedure ana_integrator (model : integer; gain : real);
+	attribute foreign of ana_integrator : procedure is "VHPIDIRECT ana_integrator";
+	procedure ana_gain (model : integer; gain : real);
+	attribute foreign of ana_gain : procedure is "VHPIDIRECT ana_gain";
+	procedure ana_biquad (model : integer; b0, b1, b2, a1, a2 : real);
+	attribute foreign of ana_biquad : procedure is "VHPIDIRECT ana_biquad";
+	procedure ana_fir (model : integer; coeffs : real_vector);
+	attribute foreign of ana_fir : procedure is "VHPIDIRECT ana_fir";
+	procedure ana_delay (model : integer; samples : integer);
+	attribute foreign of ana_delay : procedure is "VHPIDIRECT ana_delay";
+
+	-- input level change, and sample strobe, at the current simulation time:
+	procedure ana_input (model : integer; channel : integer; level : real);
+	procedure ana_sample (model : integer);
+
+	-- last output sample, as a real value or quantized to a "bits"-bit integer:
+	impure function ana_output (model : integer; channel : integer) return real;
+	attribute foreign of ana_output : function is "VHPIDIRECT ana_output";
+	impure function ana_adc (model : integer; channel : integer; scale : real; bits : integer) return integer;
+	attribute foreign of ana_adc : function is "VHPIDIRECT ana_adc";
+
+end package;
+
+package body ANAmodel is
+
+	impure function ana_create (channels : integer; clk_period : time) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	procedure ana_integrator (model : integer; gain : real) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	procedure ana_gain (model : integer; gain : real) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	procedure ana_biquad (model : integer; b0, b1, b2, a1, a2 : real) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	procedure ana_fir (model : integer; coeffs : real_vector) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	procedure ana_delay (model : integer; samples : integer) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	procedure ana_input_at (model : integer; channel : integer; level : real; t : time) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of ana_input_at : procedure is "VHPIDIRECT ana_input";
+
+	procedure ana_sample_at (model : integer; t : time) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of ana_sample_at : procedure is "VHPIDIRECT ana_sample";
+
+	procedure ana_input (model : integer; channel : integer; level : real) is
+	begin
+		ana_input_at(model, channel, level, now);
+	end;
+
+	procedure ana_sample (model : integer) is
+	begin
+		ana_sample_at(model, now);
+	end;
+
+	impure function ana_output (model : integer; channel : integer) return real is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	impure function ana_adc (model : integer; channel : integer; scale : real; bits : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+end package body;
@@ -0,0 +1,153 @@
+/*
+ * GHDL VHPIDIRECT interface to stream AXI-Stream data to and from host tools
+ * (developed for and tested with GHDL v3.0)
+ *
+ * Author:
+ *      Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *      Department of Information Engineering
+ *      Università Politecnica delle Marche (ITALY)
+ *
+ * Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Beats accepted by AXISemu.vhdl are collected into chunks, that are handed
+// over to the host through the shared-memory rings of AXISemu.h at the end
+// of each packet, when a chunk is full, or when the stream goes idle; beats
+// to be sent to VHDL are cut out of the chunks written by the host.
+
+#define _DEFAULT_SOURCE
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "AXISemu.h"
+
+#define VERBOSE false
+
+enum { max_links = 8 };
+
+
+// data types used to interface with GHDL arrays:
+
+typedef struct {
+	int32_t  left;
+	int32_t  right;
+	int32_t  dir;
+	int32_t  len;
+} range_t;
+
+typedef struct {
+	void    *data;
+	range_t *bounds;
+} array_t;
+
+typedef struct {
+	axis_link_t link;
+	uint8_t     tx[AXIS_CHUNK_MAX];     // chunk being collected
+	uint32_t    tx_len;
+	uint8_t     rx[64];                 // beat being sent to VHDL
+} stream_t;
+
+static stream_t *streams[max_links];
+static int       count;
+
+static char *string_get (const array_t *s)
+{
+	int32_t len = s->bounds->len;
+	char *str = malloc(len + 1);
+	if (!str) exit(1);
+	memcpy(str, s->data, len);
+	str[len] = '\0';
+	return str;
+}
+
+static bool tx_publish (stream_t *s, bool last)
+{
+	if (!axis_put(&s->link, axis_to_host, s->tx, s->tx_len, last)) return false;
+	s->tx_len = 0;
+	return true;
+}
+
+
+// GHLD VHPIDIRECT interface:
+
+int axis_open (const array_t *name, int32_t ring_size)
+{
+	// ring size is rounded up to a power of two:
+	char *str = string_get(name);
+	uint32_t size = 4096;
+	while (size < (uint32_t) ring_size && size < 1u << 30) size <<= 1;
+	if (count == max_links) exit(1);
+	// start afresh, without disturbing clients still attached to a previous run:
+	shm_unlink(str);
+	int fd = shm_open(str, O_RDWR | O_CREAT | O_EXCL, 0600);
+	size_t length = axis_shm_length(size);
+	if (fd == -1 || ftruncate(fd, length) == -1) {
+		perror(str);
+		exit(1);
+	}
+	void *p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		perror(str);
+		exit(1);
+	}
+	stream_t *s = calloc(1, sizeof *s);
+	if (!s) exit(1);
+	s->link.shm     = p;
+	s->link.length  = length;
+	s->link.data[0] = (uint8_t *) p + 4096;
+	s->link.data[1] = s->link.data[0] + size;
+	s->link.shm->size = size;
+	__atomic_store_n(&s->link.shm->magic, AXIS_MAGIC, __ATOMIC_RELEASE);
+	if (VERBOSE) printf("AXISemu %s: 2 x %u bytes\n", str, size);
+	free(str);
+	streams[count] = s;
+	return count++;
+}
+
+bool axis_ready (int32_t h, int32_t bytes)
+{
+	// whether a beat of "bytes" can be accepted, making room by publishing the chunk if needed:
+	stream_t *s = streams[h];
+	if (s->tx_len + bytes > AXIS_CHUNK_MAX && !tx_publish(s, false)) return false;
+	return axis_room(&s->link, axis_to_host) >= s->tx_len + bytes;
+}
+
+void axis_push (int32_t h, const array_t *data, bool last)
+{
+	// append the kept bytes of a beat, as allowed by axis_ready:
+	stream_t *s = streams[h];
+	int32_t n = data->bounds->len;
+	memcpy(s->tx + s->tx_len, data->data, n);
+	s->tx_len += n;
+	if (last) tx_publish(s, true);
+}
+
+void axis_flush (int32_t h)
+{
+	// stream idle: let the host see what has been collected so far.
+	stream_t *s = streams[h];
+	if (s->tx_len) tx_publish(s, false);
+}
+
+int axis_pull (int32_t h, int32_t bytes)
+{
+	// fetch the next beat of up to "bytes" bytes from the host, returning its length,
+	// plus 256 if it ends a packet, or -1 if there is none:
+	stream_t *s = streams[h];
+	bool last;
+	if (bytes > (int32_t) sizeof s->rx) bytes = sizeof s->rx;
+	ssize_t n = axis_get(&s->link, axis_from_host, s->rx, bytes, &last);
+	if (n == 0 && !last) return -1;
+	return n + (last ? 256 : 0);
+}
+
+int axis_byte (int32_t h, int32_t i)
+{
+	return streams[h]->rx[i];
+}
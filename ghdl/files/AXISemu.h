@@ -0,0 +1,184 @@
+/*
+ * Shared-memory AXI-Stream link between GHDL (AXISemu) and host tools
+ *
+ * Author:
+ *      Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *      Department of Information Engineering
+ *      Università Politecnica delle Marche (ITALY)
+ *
+ * Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// The VHDL side creates a POSIX shared memory object holding two lock-free
+// single-producer single-consumer rings, one per direction. Each ring carries
+// chunks of up to AXIS_CHUNK_MAX bytes, the last one of a packet (AXI-Stream
+// TLAST) being flagged as such. Host tools only need this header:
+//
+//	axis_link_t *l = axis_connect("/cosim-axis", 10000);
+//	uint8_t buf[AXIS_CHUNK_MAX];
+//	bool last;
+//	ssize_t n = axis_read(l, buf, sizeof buf, &last);  // 0 if nothing new
+//	axis_write(l, "hello", 5, true);                  // false if no room
+//
+// Reads and writes never block, so that tools can poll at their own pace.
+
+#ifndef AXISEMU_H
+#define AXISEMU_H
+
+#include <unistd.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define AXIS_MAGIC      0x53495841u  // "AXIS"
+#define AXIS_CHUNK_MAX  4096
+#define AXIS_LAST       0x80000000u
+
+enum { axis_to_host, axis_from_host };
+
+typedef struct {
+	// producer and consumer indexes in separate cache lines, as byte counts since the start:
+	uint64_t head __attribute__ ((aligned (64)));
+	uint64_t tail __attribute__ ((aligned (64)));
+} axis_ring_t;
+
+typedef struct {
+	uint32_t    magic;      // set last, once the rings are initialized
+	uint32_t    size;       // bytes of data in each ring, a power of two
+	axis_ring_t ring[2];
+} axis_shm_t;
+
+typedef struct {
+	axis_shm_t *shm;
+	size_t      length;
+	uint8_t    *data[2];
+	// chunk being read, so that it can be consumed in smaller pieces:
+	uint32_t    header;
+	uint32_t    offset;
+} axis_link_t;
+
+static inline size_t axis_shm_length (uint32_t size)
+{
+	return 4096 + 2 * (size_t) size;
+}
+
+static inline void axis_copy_in (axis_link_t *l, int r, uint64_t pos, const void *src, size_t n)
+{
+	uint32_t size = l->shm->size, at = pos & (size - 1);
+	size_t first = n < size - at ? n : size - at;
+	memcpy(l->data[r] + at, src, first);
+	memcpy(l->data[r], (const uint8_t *) src + first, n - first);
+}
+
+static inline void axis_copy_out (axis_link_t *l, int r, uint64_t pos, void *dst, size_t n)
+{
+	uint32_t size = l->shm->size, at = pos & (size - 1);
+	size_t first = n < size - at ? n : size - at;
+	memcpy(dst, l->data[r] + at, first);
+	memcpy((uint8_t *) dst + first, l->data[r], n - first);
+}
+
+static inline uint32_t axis_room (axis_link_t *l, int r)
+{
+	// largest chunk that can be put in ring r right now:
+	axis_ring_t *q = &l->shm->ring[r];
+	uint64_t used = q->head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+	uint64_t free = l->shm->size - used;
+	free = free < 8 ? 0 : free - 4;
+	return free < AXIS_CHUNK_MAX ? free : AXIS_CHUNK_MAX;
+}
+
+static inline bool axis_put (axis_link_t *l, int r, const void *data, uint32_t n, bool last)
+{
+	// producer side: the chunk is padded to 8 bytes, so that headers never wrap around.
+	if (!n && !last) return true; // a zero header means no chunk
+	if (n > axis_room(l, r)) return false;
+	axis_ring_t *q = &l->shm->ring[r];
+	uint32_t header = n | (last ? AXIS_LAST : 0);
+	axis_copy_in(l, r, q->head, &header, sizeof header);
+	axis_copy_in(l, r, q->head + sizeof header, data, n);
+	__atomic_store_n(&q->head, q->head + ((sizeof header + n + 7) & ~7u), __ATOMIC_RELEASE);
+	return true;
+}
+
+static inline ssize_t axis_get (axis_link_t *l, int r, void *data, uint32_t size, bool *last)
+{
+	// consumer side: returns up to "size" bytes of the current chunk, 0 if the ring is empty;
+	// "last" is set on the final piece of a packet.
+	axis_ring_t *q = &l->shm->ring[r];
+	if (last) *last = false;
+	if (!l->header) {
+		if (__atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == q->tail) return 0;
+		axis_copy_out(l, r, q->tail, &l->header, sizeof l->header);
+		l->offset = 0;
+	}
+	uint32_t n = (l->header & ~AXIS_LAST) - l->offset;
+	if (n > size) n = size;
+	axis_copy_out(l, r, q->tail + sizeof l->header + l->offset, data, n);
+	l->offset += n;
+	if (l->offset == (l->header & ~AXIS_LAST)) {
+		if (last) *last = l->header & AXIS_LAST;
+		__atomic_store_n(&q->tail, q->tail + ((sizeof l->header + l->offset + 7) & ~7u), __ATOMIC_RELEASE);
+		l->header = 0;
+	}
+	return n;
+}
+
+
+// host client API:
+
+static inline axis_link_t *axis_connect (const char *name, int timeout_ms)
+{
+	// attach to the link created by the VHDL simulation, waiting for it up to "timeout_ms":
+	struct timespec pause = {0, 10000000};
+	for (int waited = 0; ; waited += 10) {
+		int fd = shm_open(name, O_RDWR, 0);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > (off_t) sizeof (axis_shm_t)) {
+			void *p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+			axis_shm_t *shm = p;
+			if (p != MAP_FAILED && __atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) == AXIS_MAGIC &&
+			    axis_shm_length(shm->size) <= (size_t) st.st_size) {
+				axis_link_t *l = calloc(1, sizeof *l);
+				if (!l) return NULL;
+				l->shm     = shm;
+				l->length  = st.st_size;
+				l->data[0] = (uint8_t *) p + 4096;
+				l->data[1] = l->data[0] + shm->size;
+				return l;
+			}
+			if (p != MAP_FAILED) munmap(p, st.st_size);
+		} else if (fd >= 0) {
+			close(fd);
+		}
+		if (waited >= timeout_ms) return NULL;
+		nanosleep(&pause, NULL);
+	}
+}
+
+static inline ssize_t axis_read (axis_link_t *l, void *buf, size_t size, bool *last)
+{
+	return axis_get(l, axis_to_host, buf, size < AXIS_CHUNK_MAX ? size : AXIS_CHUNK_MAX, last);
+}
+
+static inline bool axis_write (axis_link_t *l, const void *buf, size_t len, bool last)
+{
+	return len <= AXIS_CHUNK_MAX && axis_put(l, axis_from_host, buf, len, last);
+}
+
+static inline void axis_disconnect (axis_link_t *l)
+{
+	munmap(l->shm, l->length);
+	free(l);
+}
+
+#endif
@@ -0,0 +1,145 @@
+-- Shared-memory AXI-Stream link for bulk VHDL-host communication
+--
+-- Copyright  2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+-- Department of Information Engineering
+-- Universit Politecnica delle Marche (ITALY)
+--
+-- SPDX-License-Identifier: Apache-2.0
+
+-- Beats accepted on the subordinate port are sent to the host, and beats
+-- written by the host are offered on the manager port, through a pair of
+-- lock-free rings in the POSIX shared memory object "link_name" (AXISemu.c),
+-- which host tools access with the client API of AXISemu.h. Unlike PTYemu,
+-- no serial line is simulated: a whole beat is transferred at each clock edge.
+-- TREADY only drops when the host does not keep up with the data.
+
+
+library ieee;
+	use ieee.std_logic_1164.all;
+	use ieee.numeric_std.all;
+
+use work.HDLprof.all;
+
+entity AXISemu is
+	generic (
+		link_name  : string;                -- e.g. "/cosim-axis"
+		ring_size  : positive := 2**20;     -- bytes buffered in each direction
+		data_width : positive := 32         -- a multiple of 8, up to 512
+	);
+	port (
+		aclk          : in  std_logic;
+		aresetn       : in  std_logic := '1';
+		-- to the host:
+		s_axis_tdata  : in  std_logic_vector(data_width-1   downto 0) := (others => '0');
+		s_axis_tkeep  : in  std_logic_vector(data_width/8-1 downto 0) := (others => '1');
+		s_axis_tlast  : in  std_logic := '0';
+		s_axis_tvalid : in  std_logic := '0';
+		s_axis_tready : out std_logic := '0';
+		-- from the host:
+		m_axis_tdata  : out std_logic_vector(data_width-1   downto 0) := (others => '0');
+		m_axis_tkeep  : out std_logic_vector(data_width/8-1 downto 0) := (others => '0');
+		m_axis_tlast  : out std_logic := '0';
+		m_axis_tvalid : out std_logic := '0';
+		m_axis_tready : in  std_logic := '1'
+	);
+end entity;
+
+architecture behavioral of AXISemu is
+	constant bytes : positive := data_width / 8;
+
+	impure function axis_open (name : string; ring_size : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of axis_open : function is "VHPIDIRECT axis_open";
+
+	impure function axis_ready (h : integer; bytes : integer) return boolean is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of axis_ready : function is "VHPIDIRECT axis_ready";
+
+	procedure axis_push (h : integer; data : string; last : boolean) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of axis_push : procedure is "VHPIDIRECT axis_push";
+
+	procedure axis_flush (h : integer) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of axis_flush : procedure is "VHPIDIRECT axis_flush";
+
+	impure function axis_pull (h : integer; bytes : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of axis_pull : function is "VHPIDIRECT axis_pull";
+
+	impure function axis_byte (h : integer; i : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of axis_byte : function is "VHPIDIRECT axis_byte";
+
+begin
+	assert data_width mod 8 = 0 and data_width <= 512
+		report "AXISemu: unsupported data width" severity failure;
+
+	stream : process (aclk)
+		variable h    : integer := -1;
+		variable data : string(1 to bytes);
+		variable n    : natural;
+		variable beat : integer;
+		constant prof : integer := prof_register("AXISemu stream");
+	begin
+		prof_enter(prof);
+		if rising_edge(aclk) then
+			if h < 0 then
+				h := axis_open(link_name, ring_size);
+			end if;
+			if aresetn = '0' then
+				s_axis_tready <= '0';
+				m_axis_tvalid <= '0';
+			else
+				-- to the host, only the bytes marked by TKEEP:
+				if s_axis_tvalid = '1' and s_axis_tready = '1' then
+					n := 0;
+					for i in 0 to bytes - 1 loop
+						if s_axis_tkeep(i) = '1' then
+							n := n + 1;
+							data(n) := character'val(to_integer(unsigned(s_axis_tdata(8 * i + 7 downto 8 * i))));
+						end if;
+					end loop;
+					axis_push(h, data(1 to n), s_axis_tlast = '1');
+				elsif s_axis_tvalid = '0' then
+					axis_flush(h);
+				end if;
+				s_axis_tready <= '1' when axis_ready(h, bytes) else '0';
+
+				-- from the host, as soon as the previous beat has been taken:
+				if m_axis_tvalid = '0' or m_axis_tready = '1' then
+					beat := axis_pull(h, bytes);
+					if beat >= 0 then
+						for i in 0 to bytes - 1 loop
+							if i < beat mod 256 then
+								m_axis_tdata(8 * i + 7 downto 8 * i) <= std_logic_vector(to_unsigned(axis_byte(h, i), 8));
+								m_axis_tkeep(i) <= '1';
+							else
+								m_axis_tdata(8 * i + 7 downto 8 * i) <= (others => '0');
+								m_axis_tkeep(i) <= '0';
+							end if;
+						end loop;
+						m_axis_tlast  <= '1' when beat >= 256 else '0';
+						m_axis_tvalid <= '1';
+					else
+						m_axis_tvalid <= '0';
+					end if;
+				end if;
+			end if;
+		end if;
+		prof_leave(prof);
+	end process;
+
+end architecture behavioral;
@@ -0,0 +1,82 @@
+-- Gated clock generator letting the simulation skip over idle periods
+--
+-- Copyright  2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+-- Department of Information Engineering
+-- Universit Politecnica delle Marche (ITALY)
+--
+-- SPDX-License-Identifier: Apache-2.0
+
+-- A free-running clock keeps GHDL busy even when nothing happens, e.g. while
+-- the firmware waits for a timer. Here clock edges are only generated while
+-- some client declares itself busy, or at the wake-up times the clients ask
+-- for (time'high if none): in between, GHDL jumps straight to the next event.
+-- Edges always stay on the grid of a free-running clock starting when "enable"
+-- goes true, so clients that count cycles can tell how many were suppressed
+-- from the time elapsed since their previous edge (see the PWM example).
+
+
+library ieee;
+	use ieee.std_logic_1164.all;
+
+use work.HDLprof.all;
+
+entity CLKmgr is
+	generic (
+		clk_period : time := 10 ns
+	);
+	port (
+		clk    : out std_logic := '0';
+		enable : in  boolean   := true;
+		busy   : in  std_logic_vector;  -- one per client needing every clock edge
+		wakeup : in  time_vector        -- one per client: time of the next edge needed when idle
+	);
+end entity;
+
+architecture behavioral of CLKmgr is
+begin
+
+	clock_generator : process
+		constant prof : integer := prof_register("CLKmgr clock_generator");
+		variable t0   : time;
+		variable t    : time;
+		variable r    : time;
+	begin
+		clk <= '0';
+		if not enable then
+			wait until enable;
+		end if;
+		t0 := now;
+		loop
+			prof_enter(prof);
+			t := time'high;
+			for i in wakeup'range loop
+				if wakeup(i) < t then
+					t := wakeup(i);
+				end if;
+			end loop;
+			if (or busy) = '1' or t <= now then
+				prof_leave(prof);
+				clk <= '1';
+				wait for clk_period / 2;
+				clk <= '0';
+				wait for clk_period - clk_period / 2;
+			else
+				-- all idle: sleep up to the first clock edge not before the earliest wake-up,
+				-- or until some client changes its mind:
+				prof_leave(prof);
+				if t = time'high then
+					wait on busy, wakeup;
+				else
+					r := (t - t0) mod clk_period;
+					wait on busy, wakeup for t - now + (clk_period - r) mod clk_period;
+				end if;
+				-- back onto the clock grid:
+				r := (now - t0) mod clk_period;
+				if r /= 0 ns then
+					wait for clk_period - r;
+				end if;
+			end if;
+		end loop;
+	end process;
+
+end architecture;
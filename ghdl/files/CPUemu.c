@@ -0,0 +1,253 @@
+/*
+ * GHDL VHPIDIRECT interface to the QEMU RTL bridge command link
+ * (developed for and tested with GHDL v3.0)
+ *
+ * Author:
+ *      Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *      Department of Information Engineering
+ *      Università Politecnica delle Marche (ITALY)
+ *
+ * Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _DEFAULT_SOURCE
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define VERBOSE false
+
+static struct pollfd link_rd = {.fd = -1, .events = POLLIN};
+static int link_wr = -1;
+
+// listening socket, kept open when running as a persistent server (COSIM_SERVER=1):
+static int link_server = -1;
+static bool link_tcp;
+
+// receive buffer, so that commands can be fetched one character at a time:
+static uint8_t buffer[256];
+static size_t  head, tail;
+
+// wall-clock time spent blocked waiting for commands, reported by the profiler:
+uint64_t cpu_link_idle_ns;
+
+static uint64_t link_clock (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// data types used to interface with GHDL arrays:
+
+typedef struct {
+	int32_t  left;
+	int32_t  right;
+	int32_t  dir;
+	int32_t  len;
+} range_t;
+
+typedef struct {
+	void    *data;
+	range_t *bounds;
+} array_t;
+
+static int link_open (const char *path, const char *ext, int flags)
+{
+	char *name = malloc(strlen(path) + strlen(ext) + 1);
+	if (!name) exit(1);
+	strcpy(name, path);
+	strcat(name, ext);
+	int fd = open(name, flags);
+	if (fd == -1) {
+		perror(name);
+		exit(1);
+	}
+	free(name);
+	return fd;
+}
+
+static int link_listen (const char *link)
+{
+	// wait for QEMU to connect to "unix:PATH", "seqpacket:PATH", or "tcp:HOST:PORT":
+	int fd = -1, type = SOCK_STREAM;
+	if (!strncmp(link, "unix:", 5) || !strncmp(link, "seqpacket:", 10)) {
+		if (link[0] == 's') type = SOCK_SEQPACKET;
+		struct sockaddr_un sun = {.sun_family = AF_UNIX};
+		const char *path = strchr(link, ':') + 1;
+		if (strlen(path) >= sizeof sun.sun_path) {
+			fprintf(stderr, "%s: path too long\n", link);
+			exit(1);
+		}
+		strcpy(sun.sun_path, path);
+		unlink(path); // remove stale socket if already present.
+		fd = socket(AF_UNIX, type, 0);
+		if (fd == -1 || bind(fd, (struct sockaddr *) &sun, sizeof sun) == -1) {
+			perror(link);
+			exit(1);
+		}
+	} else if (!strncmp(link, "tcp:", 4)) {
+		struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = AI_PASSIVE};
+		struct addrinfo *ai;
+		char *host = strdup(link + 4);
+		char *port = host ? strrchr(host, ':') : NULL;
+		if (!port) {
+			fprintf(stderr, "%s: missing port\n", link);
+			free(host);
+			exit(1);
+		}
+		*port++ = '\0';
+		int err = getaddrinfo(*host ? host : NULL, port, &hints, &ai);
+		free(host);
+		if (err) {
+			fprintf(stderr, "%s: cannot resolve address: %s\n", link, gai_strerror(err));
+			exit(1);
+		}
+		fd = socket(ai->ai_family, SOCK_STREAM, 0);
+		if (fd != -1) {
+			int one = 1;
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+		}
+		if (fd == -1 || bind(fd, ai->ai_addr, ai->ai_addrlen) == -1) {
+			perror(link);
+			freeaddrinfo(ai);
+			exit(1);
+		}
+		freeaddrinfo(ai);
+	} else {
+		fprintf(stderr, "%s: unknown link type\n", link);
+		exit(1);
+	}
+	if (listen(fd, 1) == -1) {
+		perror("listen");
+		exit(1);
+	}
+	printf("CPUemu waiting for QEMU on %s\n", link);
+	fflush(stdout);
+	return fd;
+}
+
+static int link_accept (int fd)
+{
+	int conn;
+	do conn = accept(fd, NULL, NULL); while (conn == -1 && errno == EINTR);
+	if (conn == -1) {
+		perror("accept");
+		exit(1);
+	}
+	if (link_tcp) {
+		int one = 1;
+		setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+	}
+	return conn;
+}
+
+
+// GHLD VHPIDIRECT interface:
+
+void cpu_link_open (const array_t *path)
+{
+	// this function can only be called once:
+	if (link_rd.fd >= 0) return;
+
+	// get link name from VHDL side, unless overridden by the environment:
+	int32_t len = path->bounds->len;
+	char *str = malloc(len + 1);
+	if (!str) exit(1);
+	memcpy(str, path->data, len);
+	str[len] = '\0';
+	const char *link = getenv("COSIM_LINK");
+	if (!link || !*link) link = str;
+
+	if (strchr(link, ':')) {
+		// native socket shared by both directions:
+		const char *server = getenv("COSIM_SERVER");
+		int fd = link_listen(link);
+		link_tcp   = link[0] == 't';
+		link_rd.fd = link_accept(fd);
+		link_wr    = link_rd.fd;
+		if (server && *server && strcmp(server, "0"))
+			link_server = fd;
+		else
+			close(fd);
+	} else {
+		// named pipes, opened in the same order as by the former textio implementation:
+		link_rd.fd = link_open(link, ".out", O_RDONLY);
+		link_wr    = link_open(link, ".in",  O_WRONLY);
+	}
+	free(str);
+}
+
+bool cpu_link_accept (void)
+{
+	// drop the current connection and, when running as a server, wait for the next one:
+	if (link_rd.fd >= 0) close(link_rd.fd);
+	link_rd.fd = link_wr = -1;
+	head = tail = 0;
+	if (link_server < 0) return false;
+	if (VERBOSE) printf("CPU link waiting for a new connection.\n");
+	link_rd.fd = link_accept(link_server);
+	link_wr    = link_rd.fd;
+	return true;
+}
+
+int cpu_link_recv (int timeout)
+{
+	// returns the next character, -1 if none arrived within "timeout" ms
+	// (a negative timeout waits forever), or -2 if the link has been closed.
+	if (link_rd.fd < 0) return -2;
+	if (head == tail) {
+		int n;
+		uint64_t t0 = timeout ? link_clock() : 0;
+		do n = poll(&link_rd, 1, timeout); while (n < 0 && errno == EINTR);
+		if (timeout) cpu_link_idle_ns += link_clock() - t0;
+		if (n == 0) return -1;
+		ssize_t r;
+		do r = read(link_rd.fd, buffer, sizeof buffer); while (r < 0 && errno == EINTR);
+		if (r <= 0) {
+			if (VERBOSE) printf("CPU link closed.\n");
+			return -2;
+		}
+		head = 0;
+		tail = r;
+	}
+	return buffer[head++];
+}
+
+void cpu_link_send (const array_t *data)
+{
+	const char *p = data->data;
+	size_t n = data->bounds->len;
+	if (link_wr < 0) {
+		if (VERBOSE) printf("CPU link not open!\n");
+		return;
+	}
+	if (VERBOSE) printf("CPU link send: %.*s", (int) n, p);
+	while (n) {
+		ssize_t w = send(link_wr, p, n, MSG_NOSIGNAL);
+		if (w < 0 && errno == ENOTSOCK) w = write(link_wr, p, n);
+		if (w < 0 && errno == EINTR) continue;
+		if (w <= 0) {
+			if (VERBOSE) printf("CPU link write error!\n");
+			return;
+		}
+		p += w;
+		n -= w;
+	}
+}
+
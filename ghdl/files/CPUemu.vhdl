@@ -21,11 +21,19 @@ library uvvm_util;
 library bitvis_vip_axilite;
 	use bitvis_vip_axilite.axilite_bfm_pkg.all;
 
+use work.HDLprof.all;
+
 entity CPUemu is
 	generic (
 		clk_period : time       := 10 ns;
 		clk_delay  : natural    := 10;
 		rst_delay  : natural    := 10;
+		poll_period: time       := 1 us;  -- command polling interval in loosely-timed mode
+		data_width : natural    := 32;    -- AXI data bus width: 32 or 64
+		clk_gating : boolean    := false; -- stop the clock while the bus and all clients are idle
+		clk_clients: positive   := 1;     -- number of CLK_BUSY and CLK_WAKEUP inputs
+		uvvm_bfm   : boolean    := false; -- use the UVVM AXI-Lite BFM instead of the built-in manager
+		bus_timeout: positive   := 1000;  -- clock cycles to wait for a subordinate response
 		fifo_path  : string
 	);
 	port (
@@ -38,8 +46,8 @@ entity CPUemu is
 		M_AXI_AWPROT    : out std_logic_vector( 2 downto 0);
 		M_AXI_AWVALID   : out std_logic;
 		M_AXI_AWREADY   : in  std_logic;
-		M_AXI_WDATA     : out std_logic_vector(31 downto 0);
-		M_AXI_WSTRB     : out std_logic_vector( 3 downto 0);
+		M_AXI_WDATA     : out std_logic_vector(data_width-1   downto 0);
+		M_AXI_WSTRB     : out std_logic_vector(data_width/8-1 downto 0);
 		M_AXI_WVALID    : out std_logic;
 		M_AXI_WREADY    : in  std_logic;
 		M_AXI_BRESP     : in  std_logic_vector( 1 downto 0);
@@ -49,12 +57,17 @@ entity CPUemu is
 		M_AXI_ARPROT    : out std_logic_vector( 2 downto 0);
 		M_AXI_ARVALID   : out std_logic;
 		M_AXI_ARREADY   : in  std_logic;
-		M_AXI_RDATA     : in  std_logic_vector(31 downto 0);
+		M_AXI_RDATA     : in  std_logic_vector(data_width-1   downto 0);
 		M_AXI_RRESP     : in  std_logic_vector( 1 downto 0);
 		M_AXI_RVALID    : in  std_logic;
 		M_AXI_RREADY    : out std_logic;
 		------------------------------------------------------------------------
-		M_IRQ_LEVEL     : in  std_logic_vector
+		M_IRQ_LEVEL     : in  std_logic_vector;
+		------------------------------------------------------------------------
+		-- clock gating requests (see CLKmgr), only used if clk_gating is true:
+		------------------------------------------------------------------------
+		CLK_BUSY        : in  std_logic_vector(clk_clients-1 downto 0) := (others => '0');
+		CLK_WAKEUP      : in  time_vector     (clk_clients-1 downto 0) := (others => time'high)
 	);
 end entity;
 
@@ -68,13 +81,41 @@ architecture behavioral of CPUemu is
 	signal   clk        : std_logic  := '0';
 	signal   rst        : std_logic  := '0';
 	signal   reset      : std_logic  := '1';
+	signal   bus_busy   : std_logic  := '0';
 	signal   irq        : std_logic_vector(31 downto 0) := (others => '0');
+	-- IRQ changes are reported by the command processor instead, once registers
+	-- to snapshot at each interrupt request have been configured by "S:" commands:
+	signal   snap_mode  : boolean    := false;
 	signal   axi_if     : t_axilite_if(
 		write_address_channel(awaddr(31 downto 0)),
-		write_data_channel(wdata(31 downto 0), wstrb(3 downto 0)),
+		write_data_channel(wdata(data_width-1 downto 0), wstrb(data_width/8-1 downto 0)),
 		read_address_channel(araddr(31 downto 0)),
-		read_data_channel(rdata(31 downto 0))
-	) := init_axilite_if_signals(32, 32);
+		read_data_channel(rdata(data_width-1 downto 0))
+	) := init_axilite_if_signals(32, data_width);
+
+	procedure cpu_link_open (path : string) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of cpu_link_open : procedure is "VHPIDIRECT cpu_link_open";
+
+	function cpu_link_recv (timeout : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of cpu_link_recv : function is "VHPIDIRECT cpu_link_recv";
+
+	impure function cpu_link_accept return boolean is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of cpu_link_accept : function is "VHPIDIRECT cpu_link_accept";
+
+	procedure cpu_link_send (data : string) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of cpu_link_send : procedure is "VHPIDIRECT cpu_link_send";
 
 begin
 	-- AXI bus connections:
@@ -109,11 +150,26 @@ begin
 
 	-- clock handling:
 	clk_enable    <= true after clk_delay * clk_period;
-	clock_generator(clk, clk_enable, clk_period, "CPU clock");
+	free_running : if not clk_gating generate
+		clock_generator(clk, clk_enable, clk_period, "CPU clock");
+	end generate;
+	gated : if clk_gating generate
+		-- the clock also runs during reset and bus transactions:
+		clock_manager : entity work.CLKmgr
+		generic map (clk_period => clk_period)
+		port map (
+			clk    => clk,
+			enable => clk_enable,
+			busy   => CLK_BUSY & (bus_busy or reset),
+			wakeup => CLK_WAKEUP
+		);
+	end generate;
 
 	reset_generator : process(rst, clk)
 		variable count : natural := rst_delay;
+		constant prof  : integer := prof_register("CPUemu reset_generator");
 	begin
+		prof_enter(prof);
 		if rst = '1' then
 			count := rst_delay;
 			reset <= '1';
@@ -124,19 +180,214 @@ begin
 				reset <= '0';
 			end if;
 		end if;
+		prof_leave(prof);
 	end process;
 
 	command_processor : process
-		file     rd_pipe : text open read_mode is fifo_path & ".out";
 		variable rd_line : line;
+		variable buf  : string(1 to 64);
+		variable len  : natural;
+		variable byte : integer;
 		variable code : character;
 		variable addr : unsigned(31 downto 0);
-		variable data : std_logic_vector(31 downto 0);
-		variable mask : std_logic_vector( 3 downto 0);
+		variable data : std_logic_vector(data_width-1   downto 0);
+		variable mask : std_logic_vector(data_width/8-1 downto 0);
+		-- transfers narrower than the bus are placed on the byte lanes selected by the address:
+		constant bus_bytes : positive := data_width / 8;
+		variable value : std_logic_vector(127 downto 0);
+		variable digits: natural;
+		variable bytes : natural;
+		variable lane  : natural;
+		-- loosely-timed mode, entered upon the first 'Q' command:
+		variable lt_mode  : boolean := false;
+		variable lt_grant : time    := 0 ns;  -- VHDL may run freely up to this time
+		variable lt_stall : boolean := false; -- grant reached, QEMU has been told
+		variable stamp    : std_logic_vector(31 downto 0);
+		-- registers read at each new interrupt request, and IRQ level last reported:
+		type     addr_vector is array (natural range <>) of unsigned(31 downto 0);
+		variable snap_addr  : addr_vector(0 to 7);
+		variable snap_count : natural := 0;
+		variable irq_sent   : std_logic_vector(31 downto 0) := (others => '0');
+		-- polling loop run on behalf of the CPU:
+		variable poll_mask  : std_logic_vector(31 downto 0);
+		variable poll_value : std_logic_vector(31 downto 0);
+		variable poll_equal : boolean;
+		variable poll_start : time;
+		variable poll_irq   : std_logic_vector(31 downto 0);
+		procedure sync_to_timestamp is
+		begin
+			-- optional "@TTTTTTTT" suffix with the VHDL time of the transaction [s]:
+			if rd_line'length > 0 then
+				 read(rd_line, code); assert code = '@';
+				hread(rd_line, stamp);
+				-- the CPU is ahead, catch up before executing the transaction:
+				if now < to_integer(unsigned(stamp)) * 1 us then
+					wait for to_integer(unsigned(stamp)) * 1 us - now;
+				end if;
+			end if;
+		end procedure;
+		procedure hread_any (variable v : out std_logic_vector(127 downto 0); variable n : out natural) is
+			-- hex value of any number of digits, up to the first non-hex character:
+			variable c : character;
+			variable d : natural;
+		begin
+			v := (others => '0');
+			n := 0;
+			while rd_line'length > 0 loop
+				c := rd_line(rd_line'left);
+				case c is
+					when '0' to '9' => d := character'pos(c) - character'pos('0');
+					when 'A' to 'F' => d := character'pos(c) - character'pos('A') + 10;
+					when 'a' to 'f' => d := character'pos(c) - character'pos('a') + 10;
+					when others     => exit;
+				end case;
+				read(rd_line, c);
+				v := v(123 downto 0) & std_logic_vector(to_unsigned(d, 4));
+				n := n + 1;
+			end loop;
+		end procedure;
+		procedure select_lane is
+		begin
+			assert bytes > 0 and bytes <= bus_bytes and bus_bytes mod bytes = 0
+				report "CPUemu interface - unsupported transfer size" severity failure;
+			lane := to_integer(addr(3 downto 0)) mod bus_bytes / bytes * bytes;
+		end procedure;
+		-- AXI-Lite transactions: the built-in manager drives address and data at once,
+		-- right away, and only spends the handshake cycles, unlike the UVVM BFM, which
+		-- carries its own configuration, logging, and alert handling at each call:
+		procedure bus_write (
+			a : in unsigned(31 downto 0);
+			d : in std_logic_vector(data_width-1   downto 0);
+			m : in std_logic_vector(data_width/8-1 downto 0)
+		) is
+			variable aw_done : boolean := false;
+			variable w_done  : boolean := false;
+		begin
+			if uvvm_bfm then
+				axilite_write(a, d, m, "CPUemu", clk, axi_if);
+				return;
+			end if;
+			axi_if.write_address_channel.awaddr  <= std_logic_vector(a);
+			axi_if.write_address_channel.awvalid <= '1';
+			axi_if.write_data_channel.wdata      <= d;
+			axi_if.write_data_channel.wstrb      <= m;
+			axi_if.write_data_channel.wvalid     <= '1';
+			axi_if.write_response_channel.bready <= '1';
+			for i in 1 to bus_timeout loop
+				wait until rising_edge(clk);
+				if not aw_done and axi_if.write_address_channel.awready = '1' then
+					axi_if.write_address_channel.awvalid <= '0';
+					aw_done := true;
+				end if;
+				if not w_done and axi_if.write_data_channel.wready = '1' then
+					axi_if.write_data_channel.wvalid <= '0';
+					w_done := true;
+				end if;
+				if axi_if.write_response_channel.bvalid = '1' then
+					axi_if.write_response_channel.bready <= '0';
+					assert axi_if.write_response_channel.bresp = "00"
+						report "CPUemu interface - write error at 0x" & to_hstring(a) severity error;
+					return;
+				end if;
+			end loop;
+			failure("CPUemu interface - no write response at 0x" & to_hstring(a));
+		end procedure;
+		procedure bus_read (
+			a : in  unsigned(31 downto 0);
+			d : out std_logic_vector(data_width-1 downto 0)
+		) is
+		begin
+			if uvvm_bfm then
+				axilite_read(a, d, "CPUemu", clk, axi_if);
+				return;
+			end if;
+			axi_if.read_address_channel.araddr  <= std_logic_vector(a);
+			axi_if.read_address_channel.arvalid <= '1';
+			axi_if.read_data_channel.rready     <= '1';
+			for i in 1 to bus_timeout loop
+				wait until rising_edge(clk);
+				if axi_if.read_address_channel.arready = '1' then
+					axi_if.read_address_channel.arvalid <= '0';
+				end if;
+				if axi_if.read_data_channel.rvalid = '1' then
+					axi_if.read_data_channel.rready <= '0';
+					assert axi_if.read_data_channel.rresp = "00"
+						report "CPUemu interface - read error at 0x" & to_hstring(a) severity error;
+					d := axi_if.read_data_channel.rdata;
+					return;
+				end if;
+			end loop;
+			failure("CPUemu interface - no read response at 0x" & to_hstring(a));
+		end procedure;
+		procedure report_irq is
+			-- in snapshot mode: a new request is preceded by a "V=" reply for each configured
+			-- register, read right away, so that its service routine need not ask for them:
+			variable word : std_logic_vector(data_width-1 downto 0);
+			variable at   : natural;
+		begin
+			if snap_count = 0 or irq = irq_sent then return; end if;
+			if (irq and not irq_sent) /= (irq'range => '0') then
+				for i in 0 to snap_count - 1 loop
+					bus_busy <= '1';
+					bus_read(snap_addr(i), word);
+					bus_busy <= '0';
+					at := to_integer(snap_addr(i)(3 downto 0)) mod bus_bytes / 4 * 4;
+					reply.data <= string'("V=") & to_hstring(to_bit_vector(word(8 * at + 31 downto 8 * at)));
+					reply.tsid <= now;
+					wait for 0 ns;
+				end loop;
+			end if;
+			irq_sent := irq;
+			reply.data <= string'("I=") & to_hstring(irq_sent);
+			reply.tsid <= now;
+			wait for 0 ns;
+		end procedure;
 	begin
-		while not endfile(rd_pipe) loop
-			readline(rd_pipe, rd_line);
-			--report rd_line(1 to rd_line'length);
+		assert data_width = 32 or data_width = 64
+			report "CPUemu interface - unsupported data width" severity failure;
+		cpu_link_open(fifo_path);
+		loop
+			-- assemble next command line, dropping line terminators:
+			len := 0;
+			loop
+				if lt_mode and now < lt_grant then
+					-- keep simulating while checking for commands from time to time:
+					byte := cpu_link_recv(0);
+					if byte = -1 then
+						wait on irq for minimum(poll_period, lt_grant - now);
+						report_irq;
+						next;
+					end if;
+				else
+					report_irq;
+					if lt_mode and not lt_stall then
+						-- tell QEMU that the granted time has been reached:
+						reply.data <= string'("Q=") & to_hstring(to_unsigned(now / 1 us, 32));
+						reply.tsid <= now;
+						wait for 0 ns;
+						lt_stall := true;
+					end if;
+					byte := cpu_link_recv(-1);
+				end if;
+				exit when byte < 0 or byte = character'pos(LF);
+				if byte /= character'pos(CR) and len < buf'length then
+					len := len + 1;
+					buf(len) := character'val(byte);
+				end if;
+			end loop;
+			-- link closed: wait for the next QEMU, if running as a server (COSIM_SERVER=1):
+			if byte = -2 then
+				exit when not cpu_link_accept;
+				-- a new session always starts in lock-step mode, with an X:RESET:
+				lt_mode  := false;
+				lt_stall := false;
+				next;
+			end if;
+			exit when byte < 0;
+			next when len = 0;
+			deallocate(rd_line);
+			rd_line := new string'(buf(1 to len));
+			--report rd_line.all;
 			read(rd_line, code);
 			case code is
 
@@ -145,13 +396,23 @@ begin
 				hread(rd_line, addr);
 				 read(rd_line, code); assert code = '<';
 				 read(rd_line, code); assert code = '=';
-				hread(rd_line, data);
+				hread_any(value, digits);
+				bytes := digits / 2;
+				select_lane;
+				data := (others => '0');
+				data(8 * (lane + bytes) - 1 downto 8 * lane) := value(8 * bytes - 1 downto 0);
 				 read(rd_line, code); assert code = '|';
-				hread(rd_line, mask);
+				hread_any(value, digits);
+				mask := (others => '0');
+				mask(lane + bytes - 1 downto lane) := value(bytes - 1 downto 0);
+				sync_to_timestamp;
 				-- execute write on bus:
-				axilite_write(addr, data, mask, "CPUemu", clk, axi_if);
-				-- TODO: error handling? axilite_write consumes BRESP internally
-				-- and raises an exception for bus errors... same for reads.
+				bus_busy <= '1';
+				bus_write(addr, data, mask);
+				bus_busy <= '0';
+				-- TODO: error handling? bus errors are only reported by VHDL
+				-- (or raise an exception in the UVVM BFM)... same for reads.
+				report_irq;
 				reply.data <= string'("W=OK      ");
 				reply.tsid <= now;
 				wait for 0 ns;
@@ -159,33 +420,111 @@ begin
 			when 'R' =>
 				 read(rd_line, code); assert code = ':';
 				hread(rd_line, addr);
+				-- optional "/N" suffix with the number of bytes to read, if not 4:
+				bytes := 4;
+				if rd_line'length > 0 and rd_line(rd_line'left) = '/' then
+					read(rd_line, code);
+					hread_any(value, digits);
+					bytes := to_integer(unsigned(value(7 downto 0)));
+				end if;
+				select_lane;
+				sync_to_timestamp;
 				-- execute read on bus:
-				axilite_read(addr, data, "CPUemu", clk, axi_if);
-				reply.data <= string'("R=") & to_hstring(to_bit_vector(data));
+				bus_busy <= '1';
+				bus_read(addr, data);
+				bus_busy <= '0';
+				value := (others => '0');
+				value(8 * bytes - 1 downto 0) := data(8 * (lane + bytes) - 1 downto 8 * lane);
+				report_irq;
+				-- wider data is preceded by a "D=" reply for each extra word, most significant first:
+				for i in (bytes - 1) / 4 downto 0 loop
+					if i > 0 then
+						reply.data <= string'("D=") & to_hstring(to_bit_vector(value(32 * i + 31 downto 32 * i)));
+					else
+						reply.data <= string'("R=") & to_hstring(to_bit_vector(value(31 downto 0)));
+					end if;
+					reply.tsid <= now;
+					wait for 0 ns;
+				end loop;
+
+			when 'P' =>
+				 read(rd_line, code); assert code = ':';
+				hread(rd_line, addr);
+				 read(rd_line, code); assert code = '&';
+				hread(rd_line, poll_mask);
+				-- "==" or "!=":
+				 read(rd_line, code); poll_equal := code = '=';
+				 read(rd_line, code); assert code = '=';
+				hread(rd_line, poll_value);
+				 read(rd_line, code); assert code = '~';
+				hread(rd_line, stamp);
+				bytes := 4;
+				select_lane;
+				-- read the register back to back, as the CPU would, until the condition holds,
+				-- the timeout [s] expires, or an IRQ line changes:
+				poll_start := now;
+				poll_irq   := irq;
+				bus_busy <= '1';
+				loop
+					bus_read(addr, data);
+					value(31 downto 0) := data(8 * lane + 31 downto 8 * lane);
+					exit when ((value(31 downto 0) and poll_mask) = poll_value) = poll_equal;
+					exit when irq /= poll_irq or now - poll_start >= to_integer(unsigned(stamp)) * 1 us;
+				end loop;
+				bus_busy <= '0';
+				report_irq;
+				-- time taken, then the last value read:
+				reply.data <= string'("P=") & to_hstring(to_unsigned((now - poll_start) / 1 us, 32));
+				reply.tsid <= now;
+				wait for 0 ns;
+				reply.data <= string'("R=") & to_hstring(to_bit_vector(value(31 downto 0)));
 				reply.tsid <= now;
 				wait for 0 ns;
 
 			when 'T' =>
 				 read(rd_line, code); assert code = ':';
-				hread(rd_line, data);
+				hread(rd_line, stamp); -- always 8 digits, whatever the data width
 				-- just allow VHDL simulator to continue for specified time or until interrupt:
-				wait on irq for to_integer(unsigned(data)) * 1 us;
+				wait on irq for to_integer(unsigned(stamp)) * 1 us;
+				report_irq;
 				reply.data <= string'("T=") & to_hstring(to_unsigned(now / 1 us, 32));
 				reply.tsid <= now;
 				wait for 0 ns;
 
+			when 'Q' =>
+				 read(rd_line, code); assert code = ':';
+				hread(rd_line, stamp);
+				-- grant simulation up to the specified time, no reply until it is reached:
+				lt_mode  := true;
+				lt_grant := to_integer(unsigned(stamp)) * 1 us;
+				lt_stall := false;
+
+			when 'S' =>
+				 read(rd_line, code); assert code = ':';
+				hread(rd_line, addr);
+				-- add a register to the interrupt snapshot (no reply):
+				assert snap_count <= snap_addr'high
+					report "CPUemu interface - too many snapshot registers" severity failure;
+				snap_addr(snap_count) := addr;
+				snap_count := snap_count + 1;
+				irq_sent   := irq; -- as already reported by the reply processor
+				snap_mode  <= true;
+
 			when 'X' =>
 				 read(rd_line, code); assert code = ':';
 				 read(rd_line, code);
 				-- process special command:
 				if code = 'R' then -- RESET
+					-- snapshot registers, if any, are configured again after each reset:
+					snap_count := 0;
+					snap_mode  <= false;
 					rst <= '1', '0' after clk_period;
 					wait for clk_period;
 					wait until reset = '0';
 					wait for clk_period;
 				end if;
 				if code = 'S' then -- STOP
-					file_close(rd_pipe);
+					prof_report;
 					std.env.finish;
 					exit;
 				end if;
@@ -200,30 +539,25 @@ begin
 		wait;
 	end process;
 
-	-- replies are handled by a different process to serialize access to the output pipe:
-	reply_processor : process(reply, irq, reset)
-		file     wr_pipe : text open write_mode is fifo_path & ".in";
-		variable wr_line : line;
+	-- replies are handled by a different process to serialize access to the output link:
+	reply_processor : process(reply'transaction, irq, reset)
+		constant prof : integer := prof_register("CPUemu reply_processor");
 	begin
-		if reply'event then
-			write(wr_line, reply.data & CR);
-			writeline(wr_pipe, wr_line);
-			flush(wr_pipe);
+		prof_enter(prof);
+		if reply'active then -- also when repeating the previous reply
+			cpu_link_send(reply.data & CR & LF);
 		end if;
 		if reset'event then
 			if reset = '0' then
-				write(wr_line, string'("X=RUNNING ") & CR);
+				cpu_link_send(string'("X=RUNNING ") & CR & LF);
 			else
-				write(wr_line, string'("X=RESET   ") & CR);
+				cpu_link_send(string'("X=RESET   ") & CR & LF);
 			end if;
-			writeline(wr_pipe, wr_line);
-			flush(wr_pipe);
 		end if;
-		if irq'event and irq /= irq'last_value then
-			write(wr_line, string'("I=") & to_hstring(irq) & CR);
-			writeline(wr_pipe, wr_line);
-			flush(wr_pipe);
+		if irq'event and irq /= irq'last_value and not snap_mode then
+			cpu_link_send(string'("I=") & to_hstring(irq) & CR & LF);
 		end if;
+		prof_leave(prof);
 	end process;
 
 end architecture behavioral;
@@ -0,0 +1,156 @@
+/*
+ * GHDL VHPIDIRECT activity profiler for testbench processes
+ * (developed for and tested with GHDL v3.0)
+ *
+ * Author:
+ *      Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *      Department of Information Engineering
+ *      Università Politecnica delle Marche (ITALY)
+ *
+ * Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// GHDL offers no per-process hooks, so processes are instrumented by hand
+// (see HDLprof.vhdl) with a call on entry and one on exit of each activation.
+// Profiling is enabled by the COSIM_PROFILE environment variable, which is
+// either "1" to print the report on stderr or the name of a file to write it to;
+// otherwise each call returns immediately.
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+// time spent blocked waiting for QEMU, accounted by CPUemu.c:
+extern uint64_t cpu_link_idle_ns;
+
+
+// data types used to interface with GHDL arrays:
+
+typedef struct {
+	int32_t  left;
+	int32_t  right;
+	int32_t  dir;
+	int32_t  len;
+} range_t;
+
+typedef struct {
+	void    *data;
+	range_t *bounds;
+} array_t;
+
+typedef struct {
+	char     name[48];
+	uint64_t wakeups;
+	uint64_t deltas;    // wake-ups at the same simulation time as the previous one
+	uint64_t wall_ns;
+	int64_t  last_time; // simulation time of last wake-up [fs]
+	uint64_t entered;   // wall-clock time of current activation, 0 if not active
+} region_t;
+
+enum { max_regions = 256 };
+
+static region_t regions[max_regions];
+static int      count;
+static int      enabled = -1;   // unknown yet
+static FILE    *output;
+static uint64_t start_ns;
+static int64_t  sim_time;       // latest simulation time seen [fs]
+static bool     reported;
+
+static uint64_t wall_ns (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int compare (const void *a, const void *b)
+{
+	const region_t *x = *(region_t * const *) a, *y = *(region_t * const *) b;
+	return x->wall_ns < y->wall_ns ? 1 : x->wall_ns > y->wall_ns ? -1 : 0;
+}
+
+void prof_report (void)
+{
+	if (enabled <= 0 || reported) return;
+	reported = true;
+	uint64_t total = wall_ns() - start_ns;
+	uint64_t busy  = 0;
+	for (int i = 0; i < count; ++i) busy += regions[i].wall_ns;
+	uint64_t idle  = cpu_link_idle_ns;
+	uint64_t other = total > busy + idle ? total - busy - idle : 0;
+	// rank by wall-clock time, leaving handles valid:
+	region_t *rank[max_regions];
+	for (int i = 0; i < count; ++i) rank[i] = &regions[i];
+	qsort(rank, count, sizeof *rank, compare);
+
+	fprintf(output, "HDL profile: %.1f ms wall-clock time, %.3f ms simulated\n", total * 1e-6, sim_time * 1e-12);
+	fprintf(output, "  %-40s %12s %12s %12s %7s\n", "process", "wake-ups", "deltas", "wall [ms]", "%");
+	for (int i = 0; i < count; ++i) {
+		const region_t *r = rank[i];
+		fprintf(output, "  %-40s %12llu %12llu %12.1f %7.1f\n", r->name,
+			(unsigned long long) r->wakeups, (unsigned long long) r->deltas,
+			r->wall_ns * 1e-6, total ? 100.0 * r->wall_ns / total : 0);
+	}
+	fprintf(output, "  %-40s %12s %12s %12.1f %7.1f\n", "(waiting for QEMU)", "", "", idle * 1e-6, total ? 100.0 * idle / total : 0);
+	fprintf(output, "  %-40s %12s %12s %12.1f %7.1f\n", "(kernel and other processes)", "", "", other * 1e-6, total ? 100.0 * other / total : 0);
+	fflush(output);
+}
+
+static bool prof_init (void)
+{
+	const char *env = getenv("COSIM_PROFILE");
+	enabled = env && *env && strcmp(env, "0");
+	if (!enabled) return false;
+	output = stderr;
+	if (strcmp(env, "1")) {
+		output = fopen(env, "w");
+		if (!output) {
+			perror(env);
+			output = stderr;
+		}
+	}
+	start_ns = wall_ns();
+	// simulations that do not end with X:STOP get their report anyway:
+	atexit(prof_report);
+	return true;
+}
+
+int prof_register (const array_t *name)
+{
+	// returns a handle for prof_enter/prof_leave, or -1 if profiling is disabled:
+	if (enabled < 0) prof_init();
+	if (!enabled || count == max_regions) return -1;
+	region_t *r = &regions[count];
+	int n = name->bounds->len;
+	if (n > sizeof r->name - 1) n = sizeof r->name - 1;
+	memcpy(r->name, name->data, n);
+	r->last_time = -1;
+	return count++;
+}
+
+void prof_enter (int32_t id, int64_t t)
+{
+	if (id < 0) return;
+	region_t *r = &regions[id];
+	++r->wakeups;
+	if (t == r->last_time) ++r->deltas;
+	r->last_time = t;
+	r->entered = wall_ns();
+	sim_time = t;
+}
+
+void prof_leave (int32_t id)
+{
+	if (id < 0) return;
+	region_t *r = &regions[id];
+	if (!r->entered) return;
+	r->wall_ns += wall_ns() - r->entered;
+	r->entered = 0;
+}
@@ -0,0 +1,68 @@
+-- Activity profiler for co-simulation testbench processes.
+--
+-- Copyright  2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+-- Department of Information Engineering
+-- Universit Politecnica delle Marche (ITALY)
+--
+-- SPDX-License-Identifier: Apache-2.0
+
+-- Processes to be profiled register themselves once and then mark each of
+-- their activations, e.g.:
+--
+--	DA : process (clk, pwm1)
+--		constant prof : integer := prof_register("DAQ analog DA");
+--	begin
+--		prof_enter(prof);
+--		...
+--		prof_leave(prof);
+--	end process;
+--
+-- Wake-ups, delta cycles, and wall-clock time of each process are ranked in a
+-- summary printed when QEMU stops the simulation, if the COSIM_PROFILE
+-- environment variable is set ("1" for stderr, or an output file name).
+
+
+package HDLprof is
+
+	impure function prof_register (name : string) return integer;
+	attribute foreign of prof_register : function is "VHPIDIRECT prof_register";
+
+	procedure prof_enter (id : integer);
+
+	procedure prof_leave (id : integer);
+	attribute foreign of prof_leave : procedure is "VHPIDIRECT prof_leave";
+
+	procedure prof_report;
+	attribute foreign of prof_report : procedure is "VHPIDIRECT prof_report";
+
+end package;
+
+package body HDLprof is
+
+	impure function prof_register (name : string) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	procedure prof_enter_at (id : integer; t : time) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of prof_enter_at : procedure is "VHPIDIRECT prof_enter";
+
+	procedure prof_enter (id : integer) is
+	begin
+		prof_enter_at(id, now);
+	end;
+
+	procedure prof_leave (id : integer) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+	procedure prof_report is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+
+end package body;
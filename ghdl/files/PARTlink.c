@@ -0,0 +1,288 @@
+/*
+ * GHDL VHPIDIRECT interface to link simulation partitions running in
+ * separate GHDL processes (developed for and tested with GHDL v3.0)
+ *
+ * Author:
+ *      Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *      Department of Information Engineering
+ *      Università Politecnica delle Marche (ITALY)
+ *
+ * Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// The two sides of a link share a POSIX shared memory object, created by side
+// 0, holding a lock-free ring of time-stamped signal values per direction and,
+// for each side, the simulation time it has reached. Publishing time T is a
+// promise that no more values stamped before T will be sent, so that the peer
+// may safely simulate up to T + lookahead (PARTlink.vhdl): this is the classic
+// conservative (null-message) synchronization, where the lookahead is the
+// latency of the signals crossing the link. Waits are busy at first, as peers
+// are expected to run on their own cores, then yield the CPU.
+
+#define _DEFAULT_SOURCE
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define VERBOSE false
+
+#define PART_MAGIC 0x54524150u  // "PART"
+
+enum { max_links = 16, slots = 1024 };
+
+
+// data types used to interface with GHDL arrays:
+
+typedef struct {
+	int32_t  left;
+	int32_t  right;
+	int32_t  dir;
+	int32_t  len;
+} range_t;
+
+typedef struct {
+	void    *data;
+	range_t *bounds;
+} array_t;
+
+typedef struct {
+	// each field in its own cache line, as they are written by different sides:
+	int64_t  time __attribute__ ((aligned (64)));   // reached by this side, in fs
+	uint64_t head __attribute__ ((aligned (64)));   // values sent by this side
+	uint64_t tail __attribute__ ((aligned (64)));   // values taken by the peer
+	int32_t  pid  __attribute__ ((aligned (64)));   // 0 until attached
+	int32_t  done;                                  // set when this side has terminated
+	int32_t  width;                                 // std_logic elements in each value
+} part_side_t;
+
+typedef struct {
+	uint32_t    magic;      // set last, once side 0 is initialized
+	part_side_t side[2];
+} part_shm_t;
+
+typedef struct {
+	part_shm_t *shm;
+	size_t      length;
+	int         me;
+	uint8_t    *ring[2];    // sent by each side
+	size_t      slot[2];    // bytes per value: time stamp, then one byte per element
+	bool        taken;      // a received value is being read
+} link_t;
+
+static link_t links[max_links];
+static int    count;
+
+static char *string_get (const array_t *s)
+{
+	int32_t len = s->bounds->len;
+	char *str = malloc(len + 1);
+	if (!str) exit(1);
+	memcpy(str, s->data, len);
+	str[len] = '\0';
+	return str;
+}
+
+static size_t slot_size (int32_t width)
+{
+	return (sizeof (int64_t) + width + 7) & ~(size_t) 7;
+}
+
+static size_t shm_length (int32_t width0, int32_t width1)
+{
+	return 4096 + slots * (slot_size(width0) + slot_size(width1));
+}
+
+static void link_map (link_t *l, void *p, size_t length, int me)
+{
+	l->shm     = p;
+	l->length  = length;
+	l->me      = me;
+	l->slot[0] = slot_size(l->shm->side[0].width);
+	l->slot[1] = slot_size(l->shm->side[1].width);
+	l->ring[0] = (uint8_t *) p + 4096;
+	l->ring[1] = l->ring[0] + slots * l->slot[0];
+}
+
+static void backoff (unsigned *spins)
+{
+	// spin for a while, then give way to other processes:
+	struct timespec pause = {0, 50000};
+	if (++*spins < 1000) return;
+	if (*spins < 20000) sched_yield(); else nanosleep(&pause, NULL);
+}
+
+static bool peer_alive (link_t *l)
+{
+	part_side_t *peer = &l->shm->side[!l->me];
+	if (__atomic_load_n(&peer->done, __ATOMIC_ACQUIRE)) return false;
+	int32_t pid = __atomic_load_n(&peer->pid, __ATOMIC_ACQUIRE);
+	if (pid && kill(pid, 0) == -1) {
+		fprintf(stderr, "PARTlink: peer partition %d died\n", pid);
+		exit(1);
+	}
+	return true;
+}
+
+static void part_exit (void)
+{
+	// let peers simulate up to the last time promised, then terminate too:
+	for (int h = 0; h < count; ++h) {
+		__atomic_store_n(&links[h].shm->side[links[h].me].done, 1, __ATOMIC_RELEASE);
+	}
+}
+
+
+// GHLD VHPIDIRECT interface:
+
+int part_open (const array_t *name, int32_t side, int32_t width_out, int32_t width_in)
+{
+	// side 0 creates the link, side 1 attaches to it, waiting for side 0 to start:
+	char *str = string_get(name);
+	if (count == max_links || side < 0 || side > 1) exit(1);
+	link_t *l = &links[count];
+	int32_t width[2] = {side ? width_in : width_out, side ? width_out : width_in};
+	size_t length = shm_length(width[0], width[1]);
+	if (side == 0) {
+		// start afresh, without disturbing a peer still attached to a previous run:
+		shm_unlink(str);
+		int fd = shm_open(str, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd == -1 || ftruncate(fd, length) == -1) {
+			perror(str);
+			exit(1);
+		}
+		void *p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (p == MAP_FAILED) {
+			perror(str);
+			exit(1);
+		}
+		part_shm_t *shm = p;
+		shm->side[0].width = width[0];
+		shm->side[1].width = width[1];
+		shm->side[0].pid   = getpid();
+		link_map(l, p, length, 0);
+		__atomic_store_n(&shm->magic, PART_MAGIC, __ATOMIC_RELEASE);
+	} else {
+		// skip objects left over by a terminated run, or already taken by another process:
+		struct timespec pause = {0, 10000000};
+		for (int waited = 0; ; waited += 10) {
+			int fd = shm_open(str, O_RDWR, 0);
+			struct stat st;
+			if (fd >= 0 && fstat(fd, &st) == 0 && (size_t) st.st_size == length) {
+				void *p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				close(fd);
+				part_shm_t *shm = p;
+				int32_t none = 0;
+				if (p != MAP_FAILED && __atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) == PART_MAGIC &&
+				    shm->side[0].width == width[0] && shm->side[1].width == width[1] &&
+				    kill(shm->side[0].pid, 0) == 0 && !shm->side[0].done &&
+				    __atomic_compare_exchange_n(&shm->side[1].pid, &none, getpid(),
+				                                false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+					link_map(l, p, length, 1);
+					break;
+				}
+				if (p != MAP_FAILED) munmap(p, length);
+			} else if (fd >= 0) {
+				close(fd);
+			}
+			if (waited == 1000) fprintf(stderr, "PARTlink %s: waiting for side 0...\n", str);
+			nanosleep(&pause, NULL);
+		}
+	}
+	if (VERBOSE) printf("PARTlink %s: side %d, %d bits out, %d bits in\n", str, side, width_out, width_in);
+	free(str);
+	if (!count) atexit(part_exit);
+	return count++;
+}
+
+void part_send (int32_t h, int64_t t, const array_t *data)
+{
+	// queue a value stamped with time t, waiting for room if the peer lags behind:
+	link_t *l = &links[h];
+	part_side_t *s = &l->shm->side[l->me];
+	unsigned spins = 0;
+	while (s->head - __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE) == slots) {
+		if (!peer_alive(l)) return; // nobody will ever read it
+		backoff(&spins);
+	}
+	uint8_t *p = l->ring[l->me] + (s->head % slots) * l->slot[l->me];
+	memcpy(p, &t, sizeof t);
+	memcpy(p + sizeof t, data->data, s->width);
+	__atomic_store_n(&s->head, s->head + 1, __ATOMIC_RELEASE);
+}
+
+void part_advance (int32_t h, int64_t t)
+{
+	// all values stamped before t have been sent:
+	link_t *l = &links[h];
+	__atomic_store_n(&l->shm->side[l->me].time, t, __ATOMIC_RELEASE);
+}
+
+int64_t part_horizon (int32_t h, int64_t lookahead)
+{
+	// time up to which this side can safely run; it must be read before
+	// taking the values received, as the peer publishes time after sending them:
+	link_t *l = &links[h];
+	int64_t t = __atomic_load_n(&l->shm->side[!l->me].time, __ATOMIC_ACQUIRE);
+	return t > INT64_MAX - lookahead ? INT64_MAX : t + lookahead;
+}
+
+bool part_recv (int32_t h)
+{
+	// move to the next value received, if any:
+	link_t *l = &links[h];
+	part_side_t *peer = &l->shm->side[!l->me];
+	if (l->taken) {
+		__atomic_store_n(&peer->tail, peer->tail + 1, __ATOMIC_RELEASE);
+		l->taken = false;
+	}
+	if (__atomic_load_n(&peer->head, __ATOMIC_ACQUIRE) == peer->tail) return false;
+	l->taken = true;
+	return true;
+}
+
+int64_t part_stamp (int32_t h)
+{
+	link_t *l = &links[h];
+	part_side_t *peer = &l->shm->side[!l->me];
+	int64_t t;
+	memcpy(&t, l->ring[!l->me] + (peer->tail % slots) * l->slot[!l->me], sizeof t);
+	return t;
+}
+
+int part_element (int32_t h, int32_t i)
+{
+	// element i of the value received, as the position of its std_logic literal:
+	link_t *l = &links[h];
+	part_side_t *peer = &l->shm->side[!l->me];
+	return l->ring[!l->me][(peer->tail % slots) * l->slot[!l->me] + sizeof (int64_t) + i];
+}
+
+bool part_wait (int32_t h, int64_t t)
+{
+	// wait for the peer to get past time t, or to send something; returns false
+	// if it has terminated instead, having sent all it had:
+	link_t *l = &links[h];
+	part_side_t *peer = &l->shm->side[!l->me];
+	unsigned spins = 0;
+	for (;;) {
+		if (__atomic_load_n(&peer->time, __ATOMIC_ACQUIRE) > t) return true;
+		if (__atomic_load_n(&peer->head, __ATOMIC_ACQUIRE) != peer->tail) return true;
+		if (spins % 1024 == 1023 && !peer_alive(l)) {
+			// values sent just before terminating:
+			return __atomic_load_n(&peer->head, __ATOMIC_ACQUIRE) != peer->tail;
+		}
+		backoff(&spins);
+	}
+}
@@ -0,0 +1,151 @@
+-- Boundary between simulation partitions running in separate GHDL processes
+--
+-- Copyright  2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+-- Department of Information Engineering
+-- Universit Politecnica delle Marche (ITALY)
+--
+-- SPDX-License-Identifier: Apache-2.0
+
+-- A testbench can be split into partitions, each elaborated as its own GHDL
+-- executable, so that they simulate concurrently on separate cores. Signals
+-- crossing between two partitions go through a pair of PARTlink instances
+-- sharing the same "link_name", one per partition, with opposite "side": what
+-- one drives on "outputs" appears on the "inputs" of the other "lookahead"
+-- later. Each side only lets its partition advance up to the time reached by
+-- the other one plus the lookahead (PARTlink.c), which is thus what bounds the
+-- parallelism: the cut should go through signals that can take such a delay,
+-- e.g. a serial line, an interrupt line, or a clock-domain crossing. When one
+-- partition terminates, the others finish as soon as they catch up with it.
+
+
+library ieee;
+	use ieee.std_logic_1164.all;
+
+use std.env.all;
+use work.HDLprof.all;
+
+entity PARTlink is
+	generic (
+		link_name : string;                 -- e.g. "/cosim-uart"
+		side      : natural range 0 to 1;   -- 0 creates the link, 1 attaches to it
+		lookahead : time := 100 ns
+	);
+	port (
+		outputs : in  std_logic_vector;     -- to the other partition
+		inputs  : out std_logic_vector      -- from the other partition
+	);
+end entity;
+
+architecture behavioral of PARTlink is
+
+	impure function part_open (name : string; side, width_out, width_in : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of part_open : function is "VHPIDIRECT part_open";
+
+	procedure part_send (h : integer; t : time; data : string) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of part_send : procedure is "VHPIDIRECT part_send";
+
+	procedure part_advance (h : integer; t : time) is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of part_advance : procedure is "VHPIDIRECT part_advance";
+
+	impure function part_horizon (h : integer; lookahead : time) return time is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of part_horizon : function is "VHPIDIRECT part_horizon";
+
+	impure function part_recv (h : integer) return boolean is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of part_recv : function is "VHPIDIRECT part_recv";
+
+	impure function part_stamp (h : integer) return time is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of part_stamp : function is "VHPIDIRECT part_stamp";
+
+	impure function part_element (h : integer; i : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of part_element : function is "VHPIDIRECT part_element";
+
+	impure function part_wait (h : integer; t : time) return boolean is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of part_wait : function is "VHPIDIRECT part_wait";
+
+begin
+	assert lookahead > 0 fs
+		report "PARTlink: lookahead must be positive" severity failure;
+
+	sync : process
+		variable h       : integer;
+		variable horizon : time;
+		constant prof    : integer := prof_register("PARTlink " & link_name);
+
+		procedure send is
+			-- each std_logic element as the position of its literal:
+			variable data : string(1 to outputs'length);
+			variable n    : natural := 0;
+		begin
+			for i in outputs'range loop
+				n := n + 1;
+				data(n) := character'val(std_logic'pos(outputs(i)));
+			end loop;
+			part_send(h, now, data);
+		end procedure;
+
+		procedure receive is
+			variable t : time;
+			variable v : std_logic_vector(0 to inputs'length - 1);
+		begin
+			while part_recv(h) loop
+				t := part_stamp(h) + lookahead;
+				assert t >= now
+					report "PARTlink " & link_name & ": causality violated" severity failure;
+				for i in v'range loop
+					v(i) := std_logic'val(part_element(h, i));
+				end loop;
+				-- values arrive in time order, so later ones never cancel earlier ones:
+				inputs <= transport v after t - now;
+			end loop;
+		end procedure;
+	begin
+		h := part_open(link_name, side, outputs'length, inputs'length);
+		send;
+		loop
+			prof_enter(prof);
+			-- the peer time must be read before its values, as they are sent first:
+			horizon := part_horizon(h, lookahead);
+			receive;
+			part_advance(h, now);
+			if horizon <= now then
+				-- wait for the peer to catch up:
+				if not part_wait(h, now - lookahead) then
+					prof_leave(prof);
+					finish;
+				end if;
+				prof_leave(prof);
+			else
+				prof_leave(prof);
+				wait on outputs for horizon - now;
+				if outputs'event then
+					send;
+				end if;
+			end if;
+		end loop;
+	end process;
+
+end architecture behavioral;
@@ -11,6 +11,8 @@ library ieee;
 	use ieee.std_logic_1164.all;
 	use ieee.numeric_std.all;
 
+use work.HDLprof.all;
+
 entity PTYemu is
 	generic (
 		baudrate : natural := 10000000;
@@ -56,7 +58,9 @@ begin
 	receiver : process (rx_clock, rx)
 		variable rxcnt : natural range 0 to 10;
 		variable shifter : std_logic_vector(9 downto 0);
+		constant prof : integer := prof_register("PTYemu receiver");
 	begin
+		prof_enter(prof);
 		if not rx_active and falling_edge(rx) then
 			rx_active <= true;
 			rxcnt := 10;
@@ -69,6 +73,7 @@ begin
 				pty_write(to_integer(unsigned(shifter)));
 			end if;
 		end if;
+		prof_leave(prof);
 	end process;
 
 	transmitter : process
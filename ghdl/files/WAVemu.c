@@ -0,0 +1,233 @@
+/*
+ * GHDL VHPIDIRECT interface to stream samples from WAV or raw files
+ * (developed for and tested with GHDL v3.0)
+ *
+ * Author:
+ *      Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *      Department of Information Engineering
+ *      Università Politecnica delle Marche (ITALY)
+ *
+ * Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Files are memory-mapped and read sequentially, one frame (a sample for each
+// channel) at a time, so that long recordings only use page cache and never
+// need to be loaded into VHDL arrays. Supported formats are WAV files with
+// 8/16/24/32-bit integer or 32/64-bit float PCM samples, and headerless raw
+// files given as "s8", "s16", "s24", "s32", "f32", or "f64" (little endian).
+
+#define _DEFAULT_SOURCE
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define VERBOSE false
+
+enum { max_files = 16 };
+
+
+// data types used to interface with GHDL arrays:
+
+typedef struct {
+	int32_t  left;
+	int32_t  right;
+	int32_t  dir;
+	int32_t  len;
+} range_t;
+
+typedef struct {
+	void    *data;
+	range_t *bounds;
+} array_t;
+
+typedef struct {
+	const uint8_t *map;
+	size_t         size;
+	const uint8_t *data;        // first frame
+	size_t         frames;
+	size_t         frame;       // current frame
+	int            channels;
+	int            bytes;       // per sample
+	bool           is_float;
+	double         rate;        // from the WAV header, 0 if unknown
+} stream_t;
+
+static stream_t streams[max_files];
+static int      count;
+
+static char *string_get (const array_t *s)
+{
+	int32_t len = s->bounds->len;
+	char *str = malloc(len + 1);
+	if (!str) exit(1);
+	memcpy(str, s->data, len);
+	str[len] = '\0';
+	return str;
+}
+
+static uint32_t le (const uint8_t *p, int n)
+{
+	uint32_t v = 0;
+	for (int i = n - 1; i >= 0; --i) v = v << 8 | p[i];
+	return v;
+}
+
+static bool wav_parse (stream_t *s, const char *name)
+{
+	// RIFF header, then a list of chunks of which only "fmt " and "data" matter:
+	if (s->size < 12 || memcmp(s->map, "RIFF", 4) || memcmp(s->map + 8, "WAVE", 4)) {
+		fprintf(stderr, "%s: not a WAV file\n", name);
+		return false;
+	}
+	const uint8_t *p = s->map + 12, *end = s->map + s->size;
+	bool fmt = false;
+	while (p + 8 <= end) {
+		uint32_t len = le(p + 4, 4);
+		const uint8_t *body = p + 8;
+		if (!memcmp(p, "fmt ", 4) && len >= 16 && body + 16 <= end) {
+			unsigned tag  = le(body, 2);
+			s->channels   = le(body + 2, 2);
+			s->rate       = le(body + 4, 4);
+			s->bytes      = le(body + 14, 2) / 8;
+			if (tag == 0xFFFE && len >= 26) tag = le(body + 24, 2); // WAVE_FORMAT_EXTENSIBLE
+			s->is_float   = tag == 3;
+			fmt = tag == 1 || tag == 3;
+		} else if (!memcmp(p, "data", 4)) {
+			if (body + len > end) len = end - body; // possibly truncated recording
+			s->data   = body;
+			s->frames = fmt && s->channels && s->bytes ? len / (s->channels * s->bytes) : 0;
+			break;
+		}
+		p = body + len + (len & 1);
+	}
+	if (!fmt || !s->data) {
+		fprintf(stderr, "%s: unsupported WAV format\n", name);
+		return false;
+	}
+	return true;
+}
+
+static bool raw_parse (stream_t *s, const char *format, int channels)
+{
+	char type;
+	int bits;
+	if (sscanf(format, "%c%d", &type, &bits) != 2 || (type != 's' && type != 'f')) return false;
+	s->is_float = type == 'f';
+	s->bytes    = bits / 8;
+	// check the sample size before dividing by it, e.g. for "s4":
+	if (bits % 8 || (s->is_float ? s->bytes != 4 && s->bytes != 8 : s->bytes < 1 || s->bytes > 4)) return false;
+	s->channels = channels;
+	s->data     = s->map;
+	s->frames   = s->size / (channels * s->bytes);
+	return true;
+}
+
+
+// GHLD VHPIDIRECT interface:
+
+int wav_open (const array_t *path, const array_t *format, int32_t channels)
+{
+	// format is "wav", or one of the raw sample formats listed above:
+	char *name = string_get(path);
+	char *fmt  = string_get(format);
+	if (count == max_files || channels < 1) exit(1);
+	stream_t *s = &streams[count];
+	int fd = open(name, O_RDONLY);
+	struct stat st;
+	if (fd == -1 || fstat(fd, &st) == -1) {
+		perror(name);
+		exit(1);
+	}
+	s->size = st.st_size;
+	s->map  = s->size ? mmap(NULL, s->size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+	close(fd);
+	if (s->map == MAP_FAILED) {
+		perror(name);
+		exit(1);
+	}
+	// samples are only read once, in order:
+	if (s->map) madvise((void *) s->map, s->size, MADV_SEQUENTIAL);
+	bool ok = strcmp(fmt, "wav") ? raw_parse(s, fmt, channels) : wav_parse(s, name);
+	ok = ok && (s->is_float ? s->bytes == 4 || s->bytes == 8 : s->bytes >= 1 && s->bytes <= 4);
+	if (!ok) {
+		fprintf(stderr, "%s: unsupported format '%s'\n", name, fmt);
+		exit(1);
+	}
+	if (VERBOSE) printf("WAVemu %s: %zu frames of %d channels, %d bytes each\n", name, s->frames, s->channels, s->bytes);
+	free(name);
+	free(fmt);
+	s->frame = -1;
+	return count++;
+}
+
+int wav_channels (int32_t h)
+{
+	return streams[h].channels;
+}
+
+double wav_rate (int32_t h)
+{
+	return streams[h].rate;
+}
+
+int wav_next (int32_t h, bool repeat)
+{
+	// move to the next frame, returning 0 at the end of the file:
+	stream_t *s = &streams[h];
+	if (++s->frame < s->frames) {
+		// let the kernel drop what has been already read every few MiB:
+		size_t stride = (size_t) s->channels * s->bytes;
+		size_t offset = s->data - s->map + s->frame * stride;
+		if (offset && offset % (4 << 20) < stride)
+			madvise((void *) s->map, offset & ~((size_t) sysconf(_SC_PAGESIZE) - 1), MADV_DONTNEED);
+		return 1;
+	}
+	if (repeat && s->frames) {
+		s->frame = 0;
+		return 1;
+	}
+	s->frame = s->frames;
+	return 0;
+}
+
+double wav_real (int32_t h, int32_t ch)
+{
+	// sample as a real value, with integer samples normalized to full scale = 1.0:
+	stream_t *s = &streams[h];
+	if (ch < 0 || ch >= s->channels || s->frame >= s->frames) return 0.0;
+	const uint8_t *p = s->data + (s->frame * s->channels + ch) * s->bytes;
+	if (s->is_float) {
+		if (s->bytes == 4) {
+			float f;
+			memcpy(&f, p, sizeof f);
+			return f;
+		}
+		double d;
+		memcpy(&d, p, sizeof d);
+		return d;
+	}
+	uint32_t v = le(p, s->bytes);
+	if (s->bytes == 1 && !strncmp((const char *) s->map, "RIFF", 4)) v ^= 0x80; // 8-bit WAV is unsigned
+	int32_t x = (int32_t) (v << (32 - 8 * s->bytes));
+	return x / 2147483648.0;
+}
+
+int wav_int (int32_t h, int32_t ch)
+{
+	// sample as a signed integer, with its original resolution (floats are scaled to 24 bits):
+	stream_t *s = &streams[h];
+	double x = wav_real(h, ch);
+	int bits = s->is_float ? 24 : 8 * s->bytes;
+	double v = x * (double) (1u << (bits - 1));
+	if (v >  2147483647.0) v =  2147483647.0;
+	if (v < -2147483648.0) v = -2147483648.0;
+	return (int) v;
+}
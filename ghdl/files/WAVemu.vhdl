@@ -0,0 +1,94 @@
+-- Memory-mapped WAV or raw file stimulus source for analog testbench inputs
+--
+-- Copyright  2023 Giorgio Biagetti <g.biagetti@staff.univpm.it>
+-- Department of Information Engineering
+-- Universit Politecnica delle Marche (ITALY)
+--
+-- SPDX-License-Identifier: Apache-2.0
+
+-- Samples are read one frame at a time from a memory-mapped file (WAVemu.c),
+-- so recordings of any length can be streamed with bounded memory. Each
+-- channel is output both as a real value, normalized to a full scale of 1.0,
+-- and as a signed integer with the resolution of the file (24 bits for floats).
+-- A new frame is output at "sample_rate" if positive, at the rate found in the
+-- WAV header if negative, or on each rising edge of "strobe" if zero.
+-- "format" is either "wav" or a raw format among s8, s16, s24, s32, f32, f64.
+
+
+library ieee;
+	use ieee.std_logic_1164.all;
+
+entity WAVemu is
+	generic (
+		file_path   : string;
+		format      : string   := "wav";
+		channels    : positive := 4;
+		sample_rate : real     := 0.0;
+		repeat      : boolean  := false  -- restart from the beginning at end of file
+	);
+	port (
+		strobe : in  std_logic := '0';
+		sample : out real_vector   (0 to channels - 1) := (others => 0.0);
+		value  : out integer_vector(0 to channels - 1) := (others => 0);
+		eof    : out boolean := false
+	);
+end entity;
+
+architecture behavioral of WAVemu is
+
+	impure function wav_open (path : string; format : string; channels : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of wav_open : function is "VHPIDIRECT wav_open";
+
+	impure function wav_rate (h : integer) return real is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of wav_rate : function is "VHPIDIRECT wav_rate";
+
+	impure function wav_next (h : integer; repeat : boolean) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of wav_next : function is "VHPIDIRECT wav_next";
+
+	impure function wav_real (h : integer; channel : integer) return real is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of wav_real : function is "VHPIDIRECT wav_real";
+
+	impure function wav_int (h : integer; channel : integer) return integer is
+	begin
+		report "VHPIDIRECT error" severity failure;
+	end;
+	attribute foreign of wav_int : function is "VHPIDIRECT wav_int";
+
+begin
+	reader : process
+		constant h : integer := wav_open(file_path, format, channels);
+		variable rate : real := sample_rate;
+	begin
+		if rate < 0.0 then
+			rate := wav_rate(h);
+			assert rate > 0.0 report "WAVemu: no sample rate for " & file_path severity failure;
+		end if;
+		loop
+			if rate = 0.0 then
+				wait until rising_edge(strobe);
+			end if;
+			exit when wav_next(h, repeat) = 0;
+			for i in 0 to channels - 1 loop
+				sample(i) <= wav_real(h, i);
+				value(i)  <= wav_int(h, i);
+			end loop;
+			if rate > 0.0 then
+				wait for 1 sec / rate;
+			end if;
+		end loop;
+		eof <= true;
+		wait;
+	end process;
+end architecture;
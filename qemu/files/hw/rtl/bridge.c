@@ -20,65 +20,448 @@
 #include "qemu/log.h"
 #include "qemu/timer.h"
 #include "qemu/thread.h"
+#include "qemu/lockable.h"
+#include "qemu/event_notifier.h"
+#include "qemu/cutils.h"
+#include "qemu/main-loop.h"
 #include "sysemu/runstate.h"
+#include "sysemu/sysemu.h"
+#include "sysemu/cpu-timers.h"
+#include "hw/clock.h"
 #include "hw/irq.h"
 #include "hw/sysbus.h"
 #include "hw/qdev-properties.h"
 #include "hw/qdev-properties-system.h"
 #include "qom/object.h"
 #include "chardev/char-fe.h"
+#include "exec/cpu-common.h"
+#include "hw/core/cpu.h"
+#include "models.h"
+#include "heatmap.h"
+#include "tracelog.h"
 
 #include "qemu/error-report.h"
 #include "qemu/sockets.h"
 
+#include <math.h>
+#include <netinet/tcp.h>
+
+#define RTL_SNAPSHOT_MAX 8
+
 struct RTLBridge {
 	SysBusDevice        parent;
 	VMChangeStateEntry *vmstate;
 
 	CharBackend         comm;
+	char               *socket;
+	int                 sock;
 	uint32_t            base;
 	uint32_t            span;
 	char               *name;
 	uint32_t            sync;
+	uint32_t            hdl_clk;
+	bool                calibrate;
+	uint32_t            quantum;
+	char               *bench;
+	char               *models_spec;
+	bool                irq_sources;    // VHDL IRQ word: raw sources in bits 7..0, VHDL INTC output in bit 8
+	CharBackend         model_chr;
+	char               *heatmap_file;
+	char               *regmap;
+	uint32_t            pace;
+	bool                keep;
+	uint32_t            width;      // data bus width towards VHDL: 32 or 64 bits
+	char               *snapshot_spec;
+	uint32_t            poll;       // identical reads from one PC after which polling moves to VHDL
+	uint32_t            poll_timeout;
+	char               *trace_file;
+	uint32_t            trace_slots;
+	uint32_t            trace_base;
 
 	MemoryRegion        iomem;
+	RTLModels          *models;     // in-QEMU functional models overlaid on iomem, if any
+	RTLHeatmap         *heatmap;    // per-register access statistics, if enabled
+	RTLTraceLog        *tracelog;   // firmware trace port, if enabled
 	qemu_irq            irq;
 	uint32_t            irq_level;
 	char                reply[12];
+	uint64_t            reply_ext;  // words preceding the last "R=" reply in "D=" replies, if any
+	uint32_t            reply_wait_us; // VHDL time spent by the last "P:" command, from its "P=" reply
 	char                guard[4];
 	QemuCond            reply_wait;
 	QemuMutex           reply_mutex;
+	// bus accesses run without the BQL: this one serializes them, together with
+	// the transactions of the main loop, and is always taken after the BQL:
+	QemuMutex           bus_mutex;
+	unsigned            sent;       // commands expecting a reply sent so far
+	unsigned            received;   // replies received so far (both protected by reply_mutex)
 	QemuThread          thread;
 	QEMUTimer          *timer;
-	int pipes[2];
+	// IRQ level received by the reader thread, and applied by the main loop:
+	EventNotifier       irq_notifier;
+	uint32_t            irq_next;   // latest level reported by VHDL (atomic)
+	bool                irq_posted; // notifier set but not yet handled (atomic)
+
+	// polling loop detector, and VHDL time run ahead of virtual time by offloaded loops:
+	struct {
+		uint32_t        reg;
+		vaddr           pc;
+		uint64_t        value;
+		unsigned        repeats;
+		uint32_t        debt;       // sync ticks to skip [µs]
+		// condition set by the firmware for the next reads of one register, until the next write:
+		bool            armed;
+		bool            equal;      // wait for (value & mask) == expected, or != if false
+		bool            bound;      // the register has been read since arming
+		uint32_t        mask;
+		uint32_t        expected;
+		uint32_t        cond_reg;
+	} pl;
+
+	// registers read by VHDL at each new IRQ, to serve the first reads of the service routine:
+	struct {
+		uint32_t        addr[RTL_SNAPSHOT_MAX];
+		unsigned        count;
+		uint32_t        value[RTL_SNAPSHOT_MAX];
+		uint32_t        valid;      // mask of the values not yet read (protected by reply_mutex)
+	} snap;
+
+	// timing calibration:
+	uint32_t            hdl_time;   // last VHDL time reported by a "T=" reply [µs]
+	uint64_t            cpu_clk;    // nominal CPU clock frequency [Hz]
+
+	// loosely-timed mode:
+	uint32_t            hdl_target; // VHDL time corresponding to current virtual time [µs]
+	uint32_t            hdl_grant;  // VHDL time up to which VHDL may run ahead [µs]
+
+	// real-time pacing, relative to the last (re)start:
+	struct {
+		int64_t         virt_ns;
+		int64_t         wall_ns;
+	} pc;
+
+	// benchmark phases, delimited by the firmware through the control registers:
+	struct {
+		FILE           *file;
+		char            phase[32];
+		int64_t         epoch;      // wall-clock time at realize [ns]
+		int64_t         virt_ns;    // virtual time at start of phase
+		int64_t         wall_ns;    // wall-clock time at start of phase
+		uint32_t        hdl_us;     // VHDL time at start of phase
+		uint64_t        reads;
+		uint64_t        writes;
+		uint64_t        irqs;
+		int64_t         irq_virt_ns; // accumulated IRQ-to-ISR latency
+		int64_t         irq_wall_ns;
+		int64_t         irq_virt_t0; // time of last IRQ assertion not yet serviced
+		int64_t         irq_wall_t0;
+		bool            irq_pending; // set by the main loop, cleared by bus accesses (atomic)
+	} bm;
+	struct {
+		int64_t         insns;      // instruction count at start of current window
+		uint32_t        hdl_time;   // VHDL time at start of current window [µs]
+		int64_t         virt_ns;    // virtual time at start of current window
+		int64_t         total_insns;
+		uint64_t        total_time;
+		int64_t         total_virt; // [ns]
+		uint64_t        total_sync; // sync times VHDL time, for its average
+		unsigned        ticks;
+		Notifier        exit;
+	} cal;
 };
 
 #define TYPE_RTL_BRIDGE "RTL-bridge"
 OBJECT_DECLARE_SIMPLE_TYPE(RTLBridge, RTL_BRIDGE)
 
-static uint64_t rtl_read (void *opaque, hwaddr addr, unsigned size)
+static void rtl_link_write (RTLBridge *rtl, const char *buf, int n)
+{
+	if (rtl->sock >= 0) {
+		qemu_write_full(rtl->sock, buf, n);
+	} else {
+		qemu_chr_fe_write_all(&rtl->comm, (uint8_t const *) buf, n);
+	}
+}
+
+static int rtl_link_read (RTLBridge *rtl, char *buf, int n)
+{
+	if (rtl->sock < 0) {
+		return qemu_chr_fe_read_all(&rtl->comm, (uint8_t *) buf, n);
+	}
+	int offset = 0;
+	while (offset < n) {
+		ssize_t r = recv(rtl->sock, buf + offset, n - offset, 0);
+		if (r < 0 && errno == EINTR) continue;
+		if (r <= 0) break;
+		offset += r;
+	}
+	return offset;
+}
+
+static int rtl_connect (const char *link, Error **errp)
+{
+	// VHDL side acts as server: "unix:PATH", "seqpacket:PATH", or "tcp:HOST:PORT".
+	int type, family;
+	const char *addr;
+	if (g_str_has_prefix(link, "unix:")) {
+		family = AF_UNIX;
+		type   = SOCK_STREAM;
+		addr   = link + 5;
+	} else if (g_str_has_prefix(link, "seqpacket:")) {
+		family = AF_UNIX;
+		type   = SOCK_SEQPACKET;
+		addr   = link + 10;
+	} else if (g_str_has_prefix(link, "tcp:")) {
+		family = AF_INET;
+		type   = SOCK_STREAM;
+		addr   = link + 4;
+	} else {
+		error_setg(errp, "RTL-bridge: unknown socket type '%s'", link);
+		return -1;
+	}
+
+	struct sockaddr_un sun = {.sun_family = AF_UNIX};
+	struct addrinfo *ai = NULL;
+	if (family == AF_UNIX) {
+		if (strlen(addr) >= sizeof sun.sun_path) {
+			error_setg(errp, "RTL-bridge: socket path too long '%s'", addr);
+			return -1;
+		}
+		strcpy(sun.sun_path, addr);
+	} else {
+		struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+		char *host = g_strdup(addr);
+		char *port = strrchr(host, ':');
+		int res = EAI_NONAME;
+		if (port) {
+			*port++ = '\0';
+			res = getaddrinfo(*host ? host : NULL, port, &hints, &ai);
+		}
+		g_free(host);
+		if (res) {
+			error_setg(errp, "RTL-bridge: cannot resolve '%s'", addr);
+			return -1;
+		}
+	}
+
+	// the VHDL simulator is usually started after QEMU, so retry for a while:
+	int err = 0;
+	for (int retry = 0; retry < 600; ++retry) {
+		int fd = socket(ai ? ai->ai_family : family, type | SOCK_CLOEXEC, 0);
+		if (fd < 0) {
+			err = errno;
+			break;
+		}
+		int r = ai ? connect(fd, ai->ai_addr, ai->ai_addrlen)
+		           : connect(fd, (struct sockaddr *) &sun, sizeof sun);
+		if (r == 0) {
+			if (ai) {
+				int one = 1;
+				setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+				freeaddrinfo(ai);
+			}
+			return fd;
+		}
+		err = errno;
+		close(fd);
+		if (err != ENOENT && err != ECONNREFUSED) break;
+		g_usleep(100000);
+	}
+	error_setg(errp, "RTL-bridge: cannot connect to '%s': %s", link, strerror(err));
+	if (ai) freeaddrinfo(ai);
+	return -1;
+}
+
+static void rtl_send (RTLBridge *rtl, const char *cmd, int n)
+{
+	// for commands that have no reply:
+	rtl_link_write(rtl, cmd, n);
+}
+
+static void rtl_transact (RTLBridge *rtl, const char *cmd, int n, char *reply)
+{
+	// VHDL replies to commands in order, so they can be matched by just counting them:
+	qemu_mutex_lock(&rtl->reply_mutex);
+	unsigned seq = ++rtl->sent;
+	qemu_mutex_unlock(&rtl->reply_mutex);
+	rtl_link_write(rtl, cmd, n);
+	if (!reply) return; // posted transaction, do not wait for completion
+	qemu_mutex_lock(&rtl->reply_mutex);
+	while ((int) (rtl->received - seq) < 0)
+		qemu_cond_wait(&rtl->reply_wait, &rtl->reply_mutex);
+	memcpy(reply, rtl->reply, sizeof rtl->reply);
+	qemu_mutex_unlock(&rtl->reply_mutex);
+}
+
+static bool rtl_snapshot_take (RTLBridge *rtl, uint32_t reg, uint64_t *val)
+{
+	QEMU_LOCK_GUARD(&rtl->reply_mutex);
+	for (unsigned i = 0; i < rtl->snap.count; ++i) {
+		if (rtl->snap.addr[i] == reg && rtl->snap.valid & 1u << i) {
+			rtl->snap.valid &= ~(1u << i);
+			*val = rtl->snap.value[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+static void rtl_snapshot_drop (RTLBridge *rtl)
+{
+	// a write may change any of the registers captured:
+	QEMU_LOCK_GUARD(&rtl->reply_mutex);
+	rtl->snap.valid = 0;
+}
+
+static void rtl_account (RTLBridge *rtl, bool write)
+{
+	if (write) ++rtl->bm.writes; else ++rtl->bm.reads;
+	if (qatomic_load_acquire(&rtl->bm.irq_pending)) {
+		// first bus access after an IRQ is assumed to come from its service routine
+		// (the main loop only sets the IRQ times while no IRQ is pending):
+		rtl->bm.irq_virt_ns += qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - rtl->bm.irq_virt_t0;
+		rtl->bm.irq_wall_ns += get_clock_realtime() - rtl->bm.irq_wall_t0;
+		++rtl->bm.irqs;
+		qatomic_store_release(&rtl->bm.irq_pending, false);
+	}
+}
+
+static void rtl_update_irq (void *opaque)
 {
 	RTLBridge *rtl = opaque;
-	uint32_t   reg = addr;
+	// IRQ lines from VHDL are combined with those of the models, if any:
+	uint32_t level = rtl->irq_sources ? rtl->irq_level >> 8 & 1 : rtl->irq_level;
+	qemu_set_irq(rtl->irq, rtl->models ? rtl_models_irq(rtl->models, rtl->irq_level) : level);
+}
+
+static void rtl_apply_irq (RTLBridge *rtl)
+{
+	// with the BQL held: take the latest level received by the reader thread:
+	uint32_t level = qatomic_read(&rtl->irq_next);
+	if (level == rtl->irq_level) return;
+	qatomic_set(&rtl->irq_level, level);
+
+	if (rtl->irq_level && !qatomic_read(&rtl->bm.irq_pending)) {
+		rtl->bm.irq_virt_t0 = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+		rtl->bm.irq_wall_t0 = get_clock_realtime();
+		qatomic_store_release(&rtl->bm.irq_pending, true);
+	}
+	rtl_update_irq(rtl);
+}
+
+static uint32_t rtl_hdl_time (RTLBridge *rtl)
+{
+	if (rtl->quantum) return rtl->hdl_target;
+	// ask VHDL for its current time, without letting it advance:
+	char reply[sizeof rtl->reply + 1] = {0};
+	rtl_transact(rtl, "T:00000000\r\n", 12, reply);
+	sscanf(reply, "T=%X", &rtl->hdl_time);
+	return rtl->hdl_time;
+}
+
+static void rtl_bench_begin (RTLBridge *rtl, uint32_t name)
+{
+	if (!rtl->bm.file) return;
+	// phase name is a NUL-terminated string in guest memory:
+	memset(rtl->bm.phase, 0, sizeof rtl->bm.phase);
+	cpu_physical_memory_read(name, rtl->bm.phase, sizeof rtl->bm.phase - 1);
+	rtl->bm.hdl_us      = rtl_hdl_time(rtl);
+	rtl->bm.virt_ns     = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+	rtl->bm.wall_ns     = get_clock_realtime();
+	rtl->bm.reads       = 0;
+	rtl->bm.writes      = 0;
+	rtl->bm.irqs        = 0;
+	rtl->bm.irq_virt_ns = 0;
+	rtl->bm.irq_wall_ns = 0;
+	qatomic_set(&rtl->bm.irq_pending, false);
+}
+
+static void rtl_bench_end (RTLBridge *rtl, uint32_t ops)
+{
+	if (!rtl->bm.file) return;
+	int64_t  wall = get_clock_realtime() - rtl->bm.wall_ns;
+	int64_t  virt = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - rtl->bm.virt_ns;
+	uint32_t hdl  = rtl_hdl_time(rtl) - rtl->bm.hdl_us;
+	fprintf(rtl->bm.file, "{\"qemu\":\"%s\",\"phase\":\"%s\",\"ops\":%u,"
+		"\"wall_ns\":%"PRId64",\"virt_ns\":%"PRId64",\"hdl_us\":%u,"
+		"\"reads\":%"PRIu64",\"writes\":%"PRIu64",\"irqs\":%"PRIu64","
+		"\"irq_wall_ns\":%"PRId64",\"irq_virt_ns\":%"PRId64",\"sync\":%u,\"quantum\":%u}\n",
+		QEMU_VERSION, rtl->bm.phase, ops, wall, virt, hdl,
+		rtl->bm.reads, rtl->bm.writes, rtl->bm.irqs,
+		rtl->bm.irq_wall_ns, rtl->bm.irq_virt_ns, rtl->sync, rtl->quantum);
+	fflush(rtl->bm.file);
+}
+
+// Simulation control registers, in the last 32 bytes of the I/O space (from span - 0x20):
+//	+0x00 W: mask of the polling condition
+//	+0x04 W: arm the polling condition: the next 32-bit reads of a register, until the next
+//	         write, wait in VHDL until (value & mask) == written value, or the poll-timeout
+//	+0x08 W: same, until (value & mask) != written value
+//	+0x10 W: 0 = stop simulation, n = advance VHDL time by n µs
+//	+0x14 R: virtual time [µs]     W: begin benchmark phase (guest address of its name)
+//	+0x18 R: wall-clock time [µs]  W: end benchmark phase (number of operations performed)
+//	+0x1C R: VHDL time [µs]         W: switch the functional model at this offset (~0 = all) to VHDL
+static uint64_t rtl_control_read (RTLBridge *rtl, uint32_t reg)
+{
+	switch (reg) {
+		case 0x4: return qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
+		case 0x8: return (get_clock_realtime() - rtl->bm.epoch) / SCALE_US;
+		case 0xC: return rtl_hdl_time(rtl);
+	}
+	return 0;
+}
+
+static uint64_t rtl_poll_read (RTLBridge *rtl, uint32_t reg, uint32_t mask, uint32_t expected, bool equal)
+{
+	// let VHDL read the register until the condition holds, an IRQ comes, or the timeout expires:
+	char cmd[48];
+	char reply[sizeof rtl->reply + 1] = {0};
+	uint64_t val = rtl->pl.value;
+	int n = snprintf(cmd, sizeof cmd, "P:%08X&%08X%c=%08X~%08X\r\n", reg, mask, equal ? '=' : '!',
+		expected, rtl->poll_timeout);
+	rtl_transact(rtl, cmd, n, reply);
+	if (sscanf(reply, "R=%"PRIx64"\r\n", &val) != 1) {
+		qemu_log_mask(LOG_GUEST_ERROR, "Wrong reply!\n");
+		return val;
+	}
+	// VHDL is now ahead of virtual time, by the time the loop would have taken,
+	// so let the CPU catch up by skipping as many sync ticks:
+	qemu_mutex_lock(&rtl->reply_mutex);
+	rtl->pl.debt += rtl->reply_wait_us;
+	qemu_mutex_unlock(&rtl->reply_mutex);
+	return val;
+}
+
+static uint64_t rtl_bus_read_single (RTLBridge *rtl, uint32_t reg, unsigned size)
+{
 	uint64_t   val = 0;
-	char cmd[32];
+	char cmd[48];
+	char reply[sizeof rtl->reply + 1] = {0};
+	int n;
 
 //	int64_t now1 = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
 
-	// Send read command:
-	int n = snprintf(cmd, sizeof cmd - 1, "R:%08X\r\n", reg);
+	// Send read command, with the transfer size if wider than 32 bits:
+	const char *wide = rtl->width == 64 ? "/8" : "";
+	if (rtl->quantum) {
+		// VHDL may be behind: make it catch up with current virtual time first:
+		n = snprintf(cmd, sizeof cmd - 1, "R:%08X%s@%08X\r\n", reg, wide, rtl->hdl_target);
+	} else {
+		n = snprintf(cmd, sizeof cmd - 1, "R:%08X%s\r\n", reg, wide);
+	}
 	if (n < sizeof cmd - 1) {
-		qemu_chr_fe_write_all(&rtl->comm, (uint8_t const *) cmd, n);
+		rtl_transact(rtl, cmd, n, reply);
 	} else {
 	    return val;
 	}
 	// Read back reply:
-	qemu_cond_wait(&rtl->reply_wait, &rtl->reply_mutex);
-	if (sscanf(rtl->reply, "R=%"PRIx64"\r\n", &val) == 1) {
+	if (sscanf(reply, "R=%"PRIx64"\r\n", &val) == 1) {
+		if (rtl->width == 64) {
+			qemu_mutex_lock(&rtl->reply_mutex);
+			val |= rtl->reply_ext << 32;
+			qemu_mutex_unlock(&rtl->reply_mutex);
+		}
 		// align byte lines:
-		val >>= (reg & 3) * 8;
-		// and also check if IRQ level has changed because of read operation:
-		qemu_set_irq(rtl->irq, rtl->irq_level);
+		val >>= (reg & (rtl->width / 8 - 1)) * 8;
 	} else {
 		qemu_log_mask(LOG_GUEST_ERROR, "Wrong reply!\n");
 	}
@@ -89,45 +472,152 @@ static uint64_t rtl_read (void *opaque, hwaddr addr, unsigned size)
 	return val;
 }
 
-static void rtl_write (void *opaque, hwaddr addr, uint64_t val, unsigned size)
+static uint64_t rtl_bus_read (void *opaque, hwaddr addr, unsigned size)
 {
 	RTLBridge *rtl = opaque;
 	uint32_t   reg = addr;
-	char cmd[32];
+	uint64_t   val = 0;
+
+	if (reg >= rtl->span - 0x20) {
+		return reg >= rtl->span - 0x10 ? rtl_control_read(rtl, reg & ~3 & 0xF) : 0;
+	}
+	rtl_account(rtl, false);
+
+	// first read of a register captured at the last IRQ, with no round trip:
+	if (rtl->snap.count && size == 4 && rtl_snapshot_take(rtl, reg, &val)) return val;
+
+	// polling condition set by the firmware, bound to the first register read after it:
+	if (rtl->pl.armed && !rtl->quantum && size == 4 && !(reg & 3) && (!rtl->pl.bound || reg == rtl->pl.cond_reg)) {
+		rtl->pl.bound    = true;
+		rtl->pl.cond_reg = reg;
+		return rtl_poll_read(rtl, reg, rtl->pl.mask, rtl->pl.expected, rtl->pl.equal);
+	}
+
+	// tight polling loops on one register are handed over to VHDL, in lock-step mode:
+	vaddr pc = 0;
+	if (rtl->poll && !rtl->quantum && size == 4 && !(reg & 3) && current_cpu) {
+		pc = CPU_GET_CLASS(current_cpu)->get_pc(current_cpu);
+		if (reg == rtl->pl.reg && pc == rtl->pl.pc && rtl->pl.repeats >= rtl->poll) {
+			val = rtl_poll_read(rtl, reg, 0xFFFFFFFF, rtl->pl.value, false);
+		} else {
+			val = (uint32_t) rtl_bus_read_single(rtl, reg, size);
+		}
+		if (reg == rtl->pl.reg && pc == rtl->pl.pc && val == rtl->pl.value) {
+			++rtl->pl.repeats;
+		} else {
+			rtl->pl.reg     = reg;
+			rtl->pl.pc      = pc;
+			rtl->pl.value   = val;
+			rtl->pl.repeats = 1;
+		}
+		return val;
+	}
+	return rtl_bus_read_single(rtl, reg, size);
+}
+
+static void rtl_model_write (void *opaque, uint32_t reg, uint32_t data, uint8_t mask)
+{
+	// used to transfer the state of a functional model into VHDL, bypassing the CPU:
+	RTLBridge *rtl = opaque;
+	char cmd[48];
+	char reply[sizeof rtl->reply + 1] = {0};
+	QEMU_LOCK_GUARD(&rtl->bus_mutex);
+	if (rtl->quantum) {
+		int n = snprintf(cmd, sizeof cmd - 1, "W:%08X<=%08X|%01X@%08X\r\n", reg, data, mask, rtl->hdl_target);
+		rtl_transact(rtl, cmd, n, NULL);
+		return;
+	}
+	int n = snprintf(cmd, sizeof cmd - 1, "W:%08X<=%08X|%01X\r\n", reg, data, mask);
+	rtl_transact(rtl, cmd, n, reply);
+	if (strncmp(reply, "W=OK      \r\n", 12) != 0) {
+		qemu_log_mask(LOG_GUEST_ERROR, "Wrong reply!\n");
+	}
+}
+
+static void rtl_switch (RTLBridge *rtl, uint64_t offset)
+{
+	if (!rtl->models || !rtl_models_switch(rtl->models, offset)) {
+		warn_report("RTL-bridge: no functional model at offset 0x%"PRIx64, offset);
+	}
+}
+
+static void rtl_bus_write (void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+	RTLBridge *rtl = opaque;
+	uint32_t   reg = addr;
+	char cmd[48];
+	char reply[sizeof rtl->reply + 1] = {0};
 	int n;
 
 //	int64_t now1 = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
 
     if (reg == rtl->span - 0x10) { // TODO: use a different iospace?
 		if (!val) {
-			// stop VHDL side:
-			n = snprintf(cmd, sizeof cmd - 1, "X:STOP    \r\n");
-			qemu_chr_fe_write_all(&rtl->comm, (uint8_t const *) cmd, n);
-			// stop QEMU side:
-			qemu_system_shutdown_request(SHUTDOWN_CAUSE_GUEST_SHUTDOWN);
+			// stop VHDL side, unless it is to be kept running for the next QEMU session
+			// (QEMU side is stopped by rtl_write, as it needs the BQL):
+			if (!rtl->keep) {
+				n = snprintf(cmd, sizeof cmd - 1, "X:STOP    \r\n");
+				rtl_send(rtl, cmd, n);
+			}
 			return;
 		} else {
 			// advance RTL simulation by some time:
 			n = snprintf(cmd, sizeof cmd - 1, "T:%08X\r\n", (uint32_t) val);
 		}
+	} else if (reg == rtl->span - 0x0C) {
+		rtl_bench_begin(rtl, val);
+		return;
+	} else if (reg == rtl->span - 0x08) {
+		rtl_bench_end(rtl, val);
+		return;
+	} else if (reg >= rtl->span - 0x10) {
+		// the model switch (span - 0x04) is handled by rtl_write, as it needs the BQL
+		return;
+	} else if (reg == rtl->span - 0x20) {
+		rtl->pl.mask = val;
+		return;
+	} else if (reg == rtl->span - 0x1C || reg == rtl->span - 0x18) {
+		rtl->pl.expected = val;
+		rtl->pl.equal    = reg == rtl->span - 0x1C;
+		rtl->pl.armed    = true;
+		rtl->pl.bound    = false;
+		return;
+	} else if (reg >= rtl->span - 0x20) {
+		return;
 	} else {
+		rtl_account(rtl, true);
+		rtl->pl.repeats = 0;
+		rtl->pl.armed   = false;
+		if (rtl->snap.count) rtl_snapshot_drop(rtl);
 		// Properly align byte lanes:
-		uint32_t data = val << (reg & 3) * 8;
-		uint8_t  mask = ((1 << size) - 1) << (reg & 3);
+		unsigned lanes = rtl->width / 8;
+		uint64_t data = val << (reg & (lanes - 1)) * 8;
+		uint8_t  mask = ((1 << size) - 1) << (reg & (lanes - 1));
+		char     word[24];
+		if (lanes == 8) {
+			snprintf(word, sizeof word, "%016"PRIX64"|%02X", data, mask);
+		} else {
+			snprintf(word, sizeof word, "%08X|%01X", (uint32_t) data, mask);
+		}
 		// Send write command:
-		n = snprintf(cmd, sizeof cmd - 1, "W:%08X<=%08X|%01X\r\n", reg, data, mask);
+		if (rtl->quantum) {
+			// timestamped and posted, the vCPU does not need to wait for VHDL:
+			n = snprintf(cmd, sizeof cmd - 1, "W:%08X<=%s@%08X\r\n", reg, word, rtl->hdl_target);
+			if (n < sizeof cmd - 1) rtl_transact(rtl, cmd, n, NULL);
+			return;
+		}
+		n = snprintf(cmd, sizeof cmd - 1, "W:%08X<=%s\r\n", reg, word);
 	}
 	if (n < sizeof cmd - 1) {
-		qemu_chr_fe_write_all(&rtl->comm, (uint8_t const *) cmd, n);
+		rtl_transact(rtl, cmd, n, reply);
 	} else {
 		return;
 	}
 	// Read back reply:
-	qemu_cond_wait(&rtl->reply_wait, &rtl->reply_mutex);
-	if (strncmp(rtl->reply, "W=OK      \r\n", 12) == 0 || strncmp(rtl->reply, "T=", 2) == 0) {
-		// all good, but check if IRQ level has changed because of write:
-		qemu_set_irq(rtl->irq, rtl->irq_level);
-	} else {
+	if (strncmp(reply, "T=", 2) == 0) {
+		sscanf(reply, "T=%X", &rtl->hdl_time);
+	}
+	if (strncmp(reply, "W=OK      \r\n", 12) != 0 && strncmp(reply, "T=", 2) != 0) {
 		qemu_log_mask(LOG_GUEST_ERROR, "Wrong reply!\n");
 	}
 
@@ -135,54 +625,205 @@ static void rtl_write (void *opaque, hwaddr addr, uint64_t val, unsigned size)
 //	printf("Write took %ld ns\n", now2 - now1);
 }
 
+// The I/O region is accessed without the BQL, so that the main loop (monitor, gdbstub,
+// chardevs, IRQ notifications) keeps running while a vCPU waits for VHDL; the BQL is
+// only taken afterwards, and only if the IRQ level changed in the meantime.
+static void rtl_access_done (RTLBridge *rtl)
+{
+	if (qatomic_read(&rtl->irq_next) == qatomic_read(&rtl->irq_level)) return;
+	qemu_mutex_lock_iothread();
+	rtl_apply_irq(rtl);
+	qemu_mutex_unlock_iothread();
+}
+
+static uint64_t rtl_read (void *opaque, hwaddr addr, unsigned size)
+{
+	RTLBridge *rtl = opaque;
+	uint64_t   val;
+	qemu_mutex_lock(&rtl->bus_mutex);
+	if (!rtl->heatmap || addr >= rtl->span - 0x20) {
+		val = rtl_bus_read(opaque, addr, size);
+	} else {
+		// time spent by the vCPU waiting for VHDL:
+		int64_t t0 = get_clock_realtime();
+		val = rtl_bus_read(opaque, addr, size);
+		rtl_heatmap_access(rtl->heatmap, addr, false, get_clock_realtime() - t0);
+	}
+	qemu_mutex_unlock(&rtl->bus_mutex);
+	rtl_access_done(rtl);
+	return val;
+}
+
+static void rtl_write (void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+	RTLBridge *rtl = opaque;
+	if (addr == rtl->span - 0x04) {
+		// models are switched under the BQL, which must be taken before the bus lock:
+		qemu_mutex_lock_iothread();
+		rtl_switch(rtl, (uint32_t) val == UINT32_MAX ? RTL_MODELS_ALL : val);
+		qemu_mutex_unlock_iothread();
+		return;
+	}
+	qemu_mutex_lock(&rtl->bus_mutex);
+	if (!rtl->heatmap || addr >= rtl->span - 0x20) {
+		rtl_bus_write(opaque, addr, val, size);
+	} else {
+		int64_t t0 = get_clock_realtime();
+		rtl_bus_write(opaque, addr, val, size);
+		rtl_heatmap_access(rtl->heatmap, addr, true, get_clock_realtime() - t0);
+	}
+	qemu_mutex_unlock(&rtl->bus_mutex);
+	if (addr == rtl->span - 0x10 && !val) {
+		// stop QEMU side:
+		qemu_mutex_lock_iothread();
+		qemu_system_shutdown_request(SHUTDOWN_CAUSE_GUEST_SHUTDOWN);
+		qemu_mutex_unlock_iothread();
+		return;
+	}
+	rtl_access_done(rtl);
+}
+
+static int64_t rtl_instructions (RTLBridge *rtl)
+{
+	// use exact instruction count if available, otherwise estimate it from the nominal CPU clock:
+	if (icount_enabled()) return icount_get_raw();
+	return muldiv64(qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL), rtl->cpu_clk, NANOSECONDS_PER_SECOND);
+}
+
+static void rtl_pace_restart (RTLBridge *rtl)
+{
+	rtl->pc.virt_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+	rtl->pc.wall_ns = get_clock();
+}
+
+static void rtl_pace (RTLBridge *rtl)
+{
+	// keep virtual time at "pace" % of wall-clock time: run freely when behind, and sleep
+	// when ahead, which also blocks VHDL as it is only let advance by this timer:
+	int64_t virt  = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - rtl->pc.virt_ns;
+	int64_t wall  = get_clock() - rtl->pc.wall_ns;
+	int64_t ahead = (int64_t) muldiv64(virt, 100, rtl->pace) - wall;
+	if (ahead > 0) {
+		// at most one paced sync period at a time, as the BQL is held here:
+		g_usleep(MIN(ahead / SCALE_US, (int64_t) rtl->sync * 100 / rtl->pace));
+	} else if (ahead < -NANOSECONDS_PER_SECOND) {
+		// too late to catch up (e.g. after a long transaction): start over from here,
+		// rather than racing until the lost time is recovered:
+		rtl_pace_restart(rtl);
+	}
+}
+
 static void rtl_reset (DeviceState *d)
 {
 	RTLBridge *rtl = RTL_BRIDGE(d);
 	rtl->irq_level = 0;
-	qemu_set_irq(rtl->irq, rtl->irq_level);
-	qemu_chr_fe_write_all(&rtl->comm, (uint8_t const *) "X:RESET   \r\n", 12);
+	if (rtl->models) rtl_models_reset(rtl->models);
+	rtl_update_irq(rtl);
+	char reply[sizeof rtl->reply + 1] = {0};
+	QEMU_LOCK_GUARD(&rtl->bus_mutex);
 	// wait for reply:
-	do
-		qemu_cond_wait(&rtl->reply_wait, &rtl->reply_mutex);
-	while (strncmp(rtl->reply, "X=RUNNING \r\n", 12) != 0);
+	rtl_transact(rtl, "X:RESET   \r\n", 12, reply);
+	if (strncmp(reply, "X=RUNNING \r\n", 12) != 0) {
+		qemu_log_mask(LOG_GUEST_ERROR, "Wrong reply!\n");
+	}
+	// VHDL time does not start from zero if the simulator was kept running by a previous session:
+	rtl_transact(rtl, "T:00000000\r\n", 12, reply);
+	sscanf(reply, "T=%X", &rtl->hdl_time);
+	// registers to capture at each IRQ, as VHDL forgets them at reset:
+	for (unsigned i = 0; i < rtl->snap.count; ++i) {
+		char cmd[16];
+		int n = snprintf(cmd, sizeof cmd, "S:%08X\r\n", rtl->snap.addr[i]);
+		rtl_send(rtl, cmd, n);
+	}
+	if (rtl->snap.count) rtl_snapshot_drop(rtl);
+	rtl->pl.repeats = 0;
+	rtl->pl.debt    = 0;
+	rtl->pl.armed   = false;
 	int64_t now = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
 	timer_mod(rtl->timer, now + rtl->sync);
+	if (rtl->quantum) {
+		// let VHDL run ahead by one quantum:
+		char cmd[16];
+		rtl->hdl_target = rtl->hdl_time;
+		rtl->hdl_grant  = rtl->hdl_target + rtl->quantum;
+		int n = snprintf(cmd, sizeof cmd, "Q:%08X\r\n", rtl->hdl_grant);
+		rtl_send(rtl, cmd, n);
+	}
+	if (rtl->pace) rtl_pace_restart(rtl);
+	// restart calibration window:
+	rtl->cal.hdl_time = rtl->hdl_time;
+	rtl->cal.insns    = rtl_instructions(rtl);
+	rtl->cal.virt_ns  = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+	rtl->cal.ticks    = 0;
 }
 
-static void rtl_incoming_notification (void *opaque)
+static void rtl_incoming_notification (EventNotifier *e)
 {
-	RTLBridge *rtl = opaque;
-	ssize_t r;
-	do {
-		r = read(rtl->pipes[0], &rtl->irq_level, sizeof rtl->irq_level);
-		if (r == 0) return;
-	} while (r < 0 && errno == EINTR);
-
-	qemu_set_irq(rtl->irq, rtl->irq_level);
+	RTLBridge *rtl = container_of(e, RTLBridge, irq_notifier);
+	event_notifier_test_and_clear(e);
+	// re-arm before reading, so that any later level gets notified again:
+	qatomic_set(&rtl->irq_posted, false);
+	smp_mb();
+	rtl_apply_irq(rtl);
 }
 
 static void *rtl_thread (void *opaque)
 {
 	RTLBridge *rtl = opaque;
 
-	uint8_t buf[12];
-	qemu_chr_fe_accept_input(&rtl->comm);
+	uint8_t buf[sizeof rtl->reply + 1] = {0};
+	uint64_t ext = 0;
+	uint32_t snap[RTL_SNAPSHOT_MAX];
+	unsigned snaps = 0;
+	if (rtl->sock < 0) qemu_chr_fe_accept_input(&rtl->comm);
 	while (true) {
-		ssize_t r = qemu_chr_fe_read_all(&rtl->comm, buf, sizeof buf);
+		ssize_t r = rtl_link_read(rtl, (char *) buf, sizeof rtl->reply);
 		if (r == sizeof rtl->reply) {
 			// Full reply packet received, process it:
-			memcpy(rtl->reply, buf, 12);
-			if (rtl->reply[0] == 'I') {
-				if (1 == sscanf(rtl->reply, "I=%X", &rtl->irq_level)) {
-					int n = qemu_write_full(rtl->pipes[1], &rtl->irq_level, sizeof rtl->irq_level);
-					if (n != sizeof rtl->irq_level) break;
+			if (buf[0] == 'I') {
+				uint32_t level;
+				if (snaps) {
+					// registers captured for this IRQ, replacing any left from the previous one:
+					qemu_mutex_lock(&rtl->reply_mutex);
+					memcpy(rtl->snap.value, snap, sizeof snap);
+					rtl->snap.valid = (1u << snaps) - 1;
+					qemu_mutex_unlock(&rtl->reply_mutex);
+					snaps = 0;
 				}
+				if (1 == sscanf((char *) buf, "I=%X", &level)) {
+					// only the latest level matters, so bursts of edges wake up the main loop once:
+					qatomic_set(&rtl->irq_next, level);
+					if (!qatomic_xchg(&rtl->irq_posted, true)) event_notifier_set(&rtl->irq_notifier);
+				}
+			} else if (buf[0] == 'Q') {
+				// VHDL reached the time granted in loosely-timed mode:
+				qemu_mutex_lock(&rtl->reply_mutex);
+				sscanf((char *) buf, "Q=%X", &rtl->hdl_time);
+				qemu_cond_broadcast(&rtl->reply_wait);
+				qemu_mutex_unlock(&rtl->reply_mutex);
+			} else if (strncmp((char *) buf, "X=RESET   \r\n", 12) == 0) {
+				// reset in progress, "X=RUNNING" will follow as the actual reply.
+			} else if (buf[0] == 'P') {
+				// VHDL time taken by a polling loop, the "R=" reply with the final value follows:
+				qemu_mutex_lock(&rtl->reply_mutex);
+				sscanf((char *) buf, "P=%X", &rtl->reply_wait_us);
+				qemu_mutex_unlock(&rtl->reply_mutex);
+			} else if (buf[0] == 'V') {
+				// snapshot of a register, in configuration order, the "I=" reply follows:
+				if (snaps < RTL_SNAPSHOT_MAX && 1 == sscanf((char *) buf, "V=%X", &snap[snaps])) ++snaps;
+			} else if (buf[0] == 'D') {
+				// upper words of a wide read, the "R=" reply with the lowest one follows:
+				uint32_t word;
+				if (1 == sscanf((char *) buf, "D=%X", &word)) ext = ext << 32 | word;
 			} else {
 				qemu_mutex_lock(&rtl->reply_mutex);
-				qemu_cond_signal(&rtl->reply_wait);
+				memcpy(rtl->reply, buf, sizeof rtl->reply);
+				rtl->reply_ext = ext;
+				ext = 0;
+				++rtl->received;
+				qemu_cond_broadcast(&rtl->reply_wait);
 				qemu_mutex_unlock(&rtl->reply_mutex);
 			}
-			// TODO: proper queue.
 		} else {
 			break;
 		}
@@ -190,26 +831,125 @@ static void *rtl_thread (void *opaque)
 	return NULL;
 }
 
+static void rtl_calibrate (RTLBridge *rtl)
+{
+	// measure over windows of 100 sync periods:
+	if (++rtl->cal.ticks < 100) return;
+	int64_t  insns = rtl_instructions(rtl) - rtl->cal.insns;
+	uint32_t time  = rtl->hdl_time - rtl->cal.hdl_time;
+	int64_t  virt  = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - rtl->cal.virt_ns;
+	rtl->cal.insns    += insns;
+	rtl->cal.hdl_time += time;
+	rtl->cal.virt_ns  += virt;
+	rtl->cal.ticks     = 0;
+	if (!time || !insns) return;
+	rtl->cal.total_insns += insns;
+	rtl->cal.total_time  += time;
+	rtl->cal.total_virt  += virt;
+	rtl->cal.total_sync  += (uint64_t) rtl->sync * time;
+
+	// instructions executed per µs of VHDL time, configured vs achieved:
+	double target = rtl->cpu_clk / 1e6;
+	double actual = (double) insns / time;
+	// VHDL time advances by 1 µs per sync period plus the bus cycles spent in transactions,
+	// so scale sync to approach the target, limiting each step to avoid oscillations:
+	double scale = target / actual;
+	if (scale > 2.0) scale = 2.0;
+	if (scale < 0.5) scale = 0.5;
+	uint32_t sync = rtl->sync * scale + 0.5;
+	rtl->sync = sync < 1 ? 1 : sync;
+}
+
+static void rtl_calibration_report (Notifier *notifier, void *data)
+{
+	RTLBridge *rtl = container_of(notifier, RTLBridge, cal.exit);
+	if (!rtl->cal.total_time) {
+		info_report("RTL-bridge calibration: no complete measurement window");
+		return;
+	}
+	double target = rtl->cpu_clk / 1e6;
+	double actual = (double) rtl->cal.total_insns / rtl->cal.total_time;
+	double virt   = (double) rtl->cal.total_virt / rtl->cal.total_time;  // virtual ns per VHDL µs
+	double sync   = (double) rtl->cal.total_sync / rtl->cal.total_time;  // average sync
+	// with the measured virtual vs VHDL time, the nearest icount shift giving the target rate,
+	// and the sync that makes up for its rounding, as virtual time per VHDL µs scales with it:
+	int shift = lround(log2(virt / target));
+	shift = MAX(0, MIN(shift, 10));
+	double suggested = sync * target * (1 << shift) / virt;
+
+	info_report("RTL-bridge calibration over %"PRIu64" µs of VHDL time:", rtl->cal.total_time);
+	info_report("  effective  %.1f instructions per VHDL µs (ratio %.3f to the %.1f configured)",
+		actual, actual / target, target);
+	info_report("  effective  CPU clock %.3f MHz, %.3f instructions per cycle of the %u Hz VHDL clock",
+		actual, actual * 1e6 / rtl->hdl_clk, rtl->hdl_clk);
+	info_report("  measured   %.1f ns of virtual time per VHDL µs (%.2f ns per instruction) with sync %.0f on average",
+		virt, (double) rtl->cal.total_virt / rtl->cal.total_insns, sync);
+	info_report("  suggested  -icount shift=%d -global RTL-bridge.sync=%u",
+		shift, suggested < 1 ? 1 : (unsigned) lround(suggested));
+}
+
+static void rtl_advance (RTLBridge *rtl)
+{
+	// loosely-timed mode: VHDL runs concurrently, at most one quantum ahead of virtual time,
+	// so synchronization is only needed at quantum boundaries:
+	++rtl->hdl_target;
+	if (rtl->calibrate) rtl_calibrate(rtl);
+	if ((int32_t) (rtl->hdl_target - rtl->hdl_grant) < 0) return;
+	// wait for VHDL to reach the boundary, if it is lagging behind:
+	qemu_mutex_lock(&rtl->reply_mutex);
+	while ((int32_t) (rtl->hdl_time - rtl->hdl_grant) < 0)
+		qemu_cond_wait(&rtl->reply_wait, &rtl->reply_mutex);
+	qemu_mutex_unlock(&rtl->reply_mutex);
+	// then grant it the next quantum:
+	char cmd[16];
+	rtl->hdl_grant = rtl->hdl_target + rtl->quantum;
+	int n = snprintf(cmd, sizeof cmd, "Q:%08X\r\n", rtl->hdl_grant);
+	rtl_send(rtl, cmd, n);
+}
+
 static void rtl_timer_cb (void *opaque)
 {
 	RTLBridge *rtl = opaque;
 	int64_t now = qemu_clock_get_us(QEMU_CLOCK_VIRTUAL);
 	timer_mod(rtl->timer, now + rtl->sync);
+	if (rtl->pace) rtl_pace(rtl);
+	QEMU_LOCK_GUARD(&rtl->bus_mutex);
+	if (rtl->quantum) {
+		rtl_advance(rtl);
+		return;
+	}
 
+	if (rtl->pl.debt) {
+		// VHDL already ran through this period, while polling for the CPU:
+		--rtl->pl.debt;
+		return;
+	}
 	char cmd[32];
+	char reply[sizeof rtl->reply + 1] = {0};
 	int n = snprintf(cmd, sizeof cmd - 1, "T:%08X\r\n", (uint32_t) 1);
-	qemu_chr_fe_write_all(&rtl->comm, (uint8_t const *) cmd, n);
-	qemu_cond_wait(&rtl->reply_wait, &rtl->reply_mutex);
-//	uint32_t t;
-//	if (1 == sscanf(rtl->reply, "T=%X", &t)) {
-//		printf("SYNC: QEMU=%ld VHDL=%u\n", now, t);
-//	}
+	rtl_transact(rtl, cmd, n, reply);
+	if (1 == sscanf(reply, "T=%X", &rtl->hdl_time)) {
+//		printf("SYNC: QEMU=%ld VHDL=%u\n", now, rtl->hdl_time);
+		if (rtl->calibrate) rtl_calibrate(rtl);
+	}
 }
 
 static const MemoryRegionOps rtl_ops = {
 	.read  = rtl_read,
 	.write = rtl_write,
 	.endianness = DEVICE_NATIVE_ENDIAN,
+	// wider accesses are split by QEMU into 32-bit transactions:
+	.valid = {.min_access_size = 1, .max_access_size = 8},
+	.impl  = {.min_access_size = 1, .max_access_size = 4},
+};
+
+static const MemoryRegionOps rtl_ops64 = {
+	.read  = rtl_read,
+	.write = rtl_write,
+	.endianness = DEVICE_NATIVE_ENDIAN,
+	// 64-bit accesses (e.g. from NEON or an AArch64 CPU) take a single transaction:
+	.valid = {.min_access_size = 1, .max_access_size = 8},
+	.impl  = {.min_access_size = 1, .max_access_size = 8},
 };
 
 static void rtl_realize (DeviceState *dev, Error **errp)
@@ -219,31 +959,127 @@ static void rtl_realize (DeviceState *dev, Error **errp)
 	Object       *cpu = object_resolve_path_type("", "arm-cpu", NULL);
 
 	qemu_mutex_init(&rtl->reply_mutex);
+	qemu_mutex_init(&rtl->bus_mutex);
 	qemu_cond_init(&rtl->reply_wait);
 	*(uint32_t *) &rtl->guard = 0;
 
-	qemu_thread_create(&rtl->thread, "RTL-bridge", rtl_thread, rtl, QEMU_THREAD_JOINABLE);
+	if (rtl->width != 32 && rtl->width != 64) {
+		error_setg(errp, "RTL-bridge: unsupported data width %u", rtl->width);
+		return;
+	}
 
-	if (!g_unix_open_pipe(rtl->pipes, FD_CLOEXEC, NULL)) {
-		error_report("Unable to create RTL-bridge pipes\n");
+	// either use a native socket or a chardev (a pipe, needing chardev.patch) to talk to VHDL:
+	rtl->sock = -1;
+	if (rtl->socket) {
+		rtl->sock = rtl_connect(rtl->socket, errp);
+		if (rtl->sock < 0) return;
+	} else if (!qemu_chr_fe_backend_connected(&rtl->comm)) {
+		error_setg(errp, "RTL-bridge: either chardev or socket must be specified");
+		return;
+	}
+
+	if (event_notifier_init(&rtl->irq_notifier, false) < 0) {
+		error_report("Unable to create RTL-bridge IRQ notifier\n");
 		exit(EXIT_FAILURE);
 	}
-	qemu_socket_set_nonblock(rtl->pipes[0]);
-	qemu_set_fd_handler(rtl->pipes[0], rtl_incoming_notification, NULL, rtl);
+	event_notifier_set_handler(&rtl->irq_notifier, rtl_incoming_notification);
 
-	memory_region_init_io(&rtl->iomem, OBJECT(rtl), &rtl_ops, rtl, "RTL-bridge", rtl->span);
+	qemu_thread_create(&rtl->thread, "RTL-bridge", rtl_thread, rtl, QEMU_THREAD_JOINABLE);
+
+	memory_region_init_io(&rtl->iomem, OBJECT(rtl), rtl->width == 64 ? &rtl_ops64 : &rtl_ops, rtl, "RTL-bridge", rtl->span);
+	memory_region_clear_global_locking(&rtl->iomem);
 	sysbus_init_mmio(bus, &rtl->iomem);
 	sysbus_init_irq(bus, &rtl->irq);
 	sysbus_mmio_map(bus, 0, rtl->base);
 	sysbus_connect_irq(bus, 0, qdev_get_gpio_in(DEVICE(cpu), 0 /*ARM_CPU_IRQ*/));
 
 	rtl->timer = timer_new_us(QEMU_CLOCK_VIRTUAL, rtl_timer_cb, rtl);
+
+	// nominal CPU clock, as set by the machine:
+	Object *clk = object_resolve_path_component(qdev_get_machine(), "ps_clk");
+	if (clk && object_dynamic_cast(clk, TYPE_CLOCK)) {
+		rtl->cpu_clk = clock_get_hz(CLOCK(clk));
+	}
+	if (!rtl->cpu_clk) {
+		rtl->cpu_clk = 120000000;
+	}
+	if (!rtl->hdl_clk) {
+		error_setg(errp, "RTL-bridge: hdl-clk must not be zero");
+		return;
+	}
+	if (rtl->pace && !icount_enabled()) {
+		// virtual time would follow the host clock, and keep running while sleeping:
+		error_setg(errp, "RTL-bridge: pace requires -icount");
+		return;
+	}
+	if (rtl->models_spec) {
+		// hybrid mode: some address ranges are served by C models instead of VHDL:
+		RTLModelHost host = {
+			.owner      = OBJECT(rtl),
+			.container  = &rtl->iomem,
+			.sync       = &rtl->sync,
+			.hdl_clk    = rtl->hdl_clk,
+			.irq_sources = rtl->irq_sources,
+			.chr        = &rtl->model_chr,
+			.update_irq = rtl_update_irq,
+			.write      = rtl_model_write,
+			.opaque     = rtl,
+		};
+		Error *err = NULL;
+		rtl->models = rtl_models_create(&host, rtl->models_spec, &err);
+		if (err) {
+			error_propagate(errp, err);
+			return;
+		}
+	}
+	if (rtl->snapshot_spec) {
+		// e.g. "0x4008,0x1008": offsets of 32-bit registers, at most RTL_SNAPSHOT_MAX:
+		char **items = g_strsplit(rtl->snapshot_spec, ",", -1);
+		for (int i = 0; items[i]; ++i) {
+			uint64_t offset;
+			if (rtl->snap.count == RTL_SNAPSHOT_MAX || qemu_strtou64(items[i], NULL, 0, &offset) < 0 ||
+			    offset >= rtl->span - 0x20 || offset & 3) {
+				error_setg(errp, "RTL-bridge: bad snapshot register '%s'", items[i]);
+				g_strfreev(items);
+				return;
+			}
+			rtl->snap.addr[rtl->snap.count++] = offset;
+		}
+		g_strfreev(items);
+	}
+	if (rtl->heatmap_file) {
+		rtl->heatmap = rtl_heatmap_create(rtl->heatmap_file, rtl->regmap, errp);
+		if (!rtl->heatmap) return;
+	}
+	if (rtl->trace_file) {
+		// served by QEMU alone, right after the I/O space unless placed elsewhere:
+		rtl->tracelog = rtl_tracelog_create(OBJECT(rtl), rtl->trace_file, rtl->trace_slots, &rtl->hdl_time, errp);
+		if (!rtl->tracelog) return;
+		sysbus_init_mmio(bus, rtl_tracelog_region(rtl->tracelog));
+		sysbus_mmio_map(bus, 1, rtl->trace_base ? rtl->trace_base : rtl->base + rtl->span);
+	}
+	rtl->bm.epoch = get_clock_realtime();
+	if (rtl->bench) {
+		rtl->bm.file = fopen(rtl->bench, "w");
+		if (!rtl->bm.file) {
+			error_setg(errp, "RTL-bridge: cannot create '%s': %s", rtl->bench, strerror(errno));
+			return;
+		}
+	}
+	if (rtl->calibrate) {
+		rtl->cal.exit.notify = rtl_calibration_report;
+		qemu_add_exit_notifier(&rtl->cal.exit);
+	}
 }
 
 static void rtl_unrealize (DeviceState *dev)
 {
 	RTLBridge *rtl = RTL_BRIDGE(dev);
-	qemu_chr_fe_disconnect(&rtl->comm);
+	if (rtl->sock >= 0) {
+		shutdown(rtl->sock, SHUT_RDWR);
+	} else {
+		qemu_chr_fe_disconnect(&rtl->comm);
+	}
 	qemu_thread_join(&rtl->thread);
 }
 
@@ -251,8 +1087,9 @@ static void rtl_unrealize (DeviceState *dev)
 static void rtl_bridge_vm_state_change (void *opaque, bool running, RunState state)
 {
 	RTLBridge *rtl = opaque;
-	(void) rtl; // unused;
 //	printf("STATE: %d (%d)\n", state, running);
+	// time spent stopped (e.g. in the debugger) is not to be made up for:
+	if (running && rtl->pace) rtl_pace_restart(rtl);
 }
 
 static void rtl_bridge_inst_init (Object *obj)
@@ -269,13 +1106,52 @@ static void rtl_bridge_inst_finalize (Object *obj)
 
 static Property rtl_bridge_properties[] = {
 	DEFINE_PROP_CHR("chardev", RTLBridge, comm),              // pipe or socket to use to communicate with the VHDL simulator
+	DEFINE_PROP_STRING("socket", RTLBridge, socket),          // or native socket instead: unix:PATH, seqpacket:PATH, tcp:HOST:PORT
 	DEFINE_PROP_UINT32("base", RTLBridge, base, 0xE0000000),  // base address of emulated I/O space
-	DEFINE_PROP_UINT32("span", RTLBridge, span, 0x01000000),  // span of emulated I/O space: last 16 bytes are reserved for simulation control
+	DEFINE_PROP_UINT32("span", RTLBridge, span, 0x01000000),  // span of emulated I/O space: last 32 bytes are reserved for simulation control
 	DEFINE_PROP_UINT32("sync", RTLBridge, sync, 1000),        // advance VHDL time by 1 µs every "sync" µs of virtual CPU time
+	DEFINE_PROP_UINT32("width", RTLBridge, width, 32),        // VHDL data bus width: 32 or 64 (must match CPUemu data_width)
+	DEFINE_PROP_UINT32("hdl-clk", RTLBridge, hdl_clk, 100000000), // VHDL bus clock frequency (must match CPUemu clk_period)
+	DEFINE_PROP_BOOL("calibrate", RTLBridge, calibrate, false),   // adapt "sync" to the CPU clock and report timing ratios at exit
+	DEFINE_PROP_UINT32("quantum", RTLBridge, quantum, 0),     // let VHDL run ahead by up to "quantum" µs (0 = lock-step)
+	DEFINE_PROP_UINT32("pace", RTLBridge, pace, 0),           // keep virtual time at "pace" % of real time (0 = as fast as possible)
+	DEFINE_PROP_BOOL("keep", RTLBridge, keep, false),         // leave the VHDL simulator running at exit, for the next QEMU to connect to
+	DEFINE_PROP_STRING("snapshot", RTLBridge, snapshot_spec), // registers read by VHDL at each new IRQ, e.g. "0x4008,0x1008"
+	DEFINE_PROP_UINT32("poll", RTLBridge, poll, 0),           // hand polling loops over to VHDL after this many identical reads (0 = never)
+	DEFINE_PROP_UINT32("poll-timeout", RTLBridge, poll_timeout, 100), // longest VHDL time of an offloaded polling loop [µs]
+	DEFINE_PROP_STRING("bench", RTLBridge, bench),            // file to write benchmark phase results to (JSON lines)
+	DEFINE_PROP_STRING("models", RTLBridge, models_spec),     // C models for some address ranges, e.g. "uart@0x0000:0,pwm@0x1000:1"
+	DEFINE_PROP_CHR("model-chardev", RTLBridge, model_chr),   // host side of the UART model
+	DEFINE_PROP_BOOL("irq-sources", RTLBridge, irq_sources, false), // VHDL also sends its raw IRQ sources (needed by the intc model)
+	DEFINE_PROP_STRING("heatmap", RTLBridge, heatmap_file),   // file to write per-register statistics to at exit (JSON lines if *.json)
+	DEFINE_PROP_STRING("regmap", RTLBridge, regmap),          // register names for the heatmap ("OFFSET NAME" lines)
+	DEFINE_PROP_STRING("trace", RTLBridge, trace_file),       // ring file of firmware trace records (decoded by trace-decode)
+	DEFINE_PROP_UINT32("trace-slots", RTLBridge, trace_slots, 65536), // records kept in the trace ring
+	DEFINE_PROP_UINT32("trace-base", RTLBridge, trace_base, 0),   // address of the trace port (0 = base + span)
 	DEFINE_PROP_STRING("name", RTLBridge, name),
 	DEFINE_PROP_END_OF_LIST(),
 };
 
+static char *rtl_get_models (Object *obj, Error **errp)
+{
+	RTLBridge *rtl = RTL_BRIDGE(obj);
+	return rtl->models ? rtl_models_spec(rtl->models) : g_strdup("");
+}
+
+static void rtl_set_switch (Object *obj, const char *value, Error **errp)
+{
+	// e.g. "qom-set /machine/peripheral-anon/device[0] switch 0x1000" from the monitor:
+	RTLBridge *rtl = RTL_BRIDGE(obj);
+	uint64_t offset;
+	if (!strcmp(value, "all")) {
+		offset = RTL_MODELS_ALL;
+	} else if (qemu_strtou64(value, NULL, 0, &offset) < 0) {
+		error_setg(errp, "RTL-bridge: bad model offset '%s'", value);
+		return;
+	}
+	rtl_switch(rtl, offset);
+}
+
 static void rtl_bridge_class_init (ObjectClass *klass, void *data)
 {
 	DeviceClass *dc = DEVICE_CLASS(klass);
@@ -287,6 +1163,8 @@ static void rtl_bridge_class_init (ObjectClass *klass, void *data)
 	dc->hotpluggable = true;
 	dc->user_creatable = true;
 	device_class_set_props(dc, rtl_bridge_properties);
+	// run-time switch of functional models to VHDL, and list of the remaining ones:
+	object_class_property_add_str(klass, "switch", rtl_get_models, rtl_set_switch);
 }
 
 static const TypeInfo rtl_bridge_info = {
@@ -0,0 +1,223 @@
+/*
+ * Per-register access statistics of the RTL bridge
+ *
+ * Author:
+ *	Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *	Department of Information Engineering
+ *	Università Politecnica delle Marche (ITALY)
+ *
+ * This file Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Each register forwarded to VHDL gets its read and write counts, the wall-clock
+// time the vCPU spent waiting for them, and the guest PCs that accessed it most.
+// PCs are those of the translation block issuing the access, which is enough to
+// tell apart the loops of a driver, and are labelled with the ELF symbols known
+// to QEMU, if any; registers are labelled from an optional register map.
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qemu/error-report.h"
+#include "sysemu/sysemu.h"
+#include "hw/core/cpu.h"
+#include "disas/disas.h"
+#include "heatmap.h"
+
+enum { top_pcs = 4 };
+
+typedef struct RTLHeatReg {
+	uint32_t     offset;
+	uint64_t     reads;
+	uint64_t     writes;
+	int64_t      stall_ns;
+	struct {
+		vaddr    pc;
+		uint64_t count;         // approximate once more than top_pcs PCs were seen
+	}            top[top_pcs];
+} RTLHeatReg;
+
+typedef struct RTLRegName {
+	uint32_t     offset;
+	char        *name;
+} RTLRegName;
+
+struct RTLHeatmap {
+	GHashTable  *regs;          // RTLHeatReg by offset
+	RTLRegName  *names;         // sorted by offset
+	unsigned     num_names;
+	char        *file;
+	bool         json;
+	Notifier     exit;
+};
+
+static int rtl_regname_compare (const void *a, const void *b)
+{
+	const RTLRegName *x = a, *y = b;
+	return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+static bool rtl_regmap_load (RTLHeatmap *hm, const char *regmap, Error **errp)
+{
+	// one "OFFSET NAME" pair per line, with '#' starting a comment:
+	FILE *f = fopen(regmap, "r");
+	if (!f) {
+		error_setg(errp, "RTL-bridge: cannot open '%s': %s", regmap, strerror(errno));
+		return false;
+	}
+	char line[256], name[128];
+	unsigned long offset;
+	unsigned size = 0;
+	while (fgets(line, sizeof line, f)) {
+		char *comment = strchr(line, '#');
+		if (comment) *comment = '\0';
+		if (sscanf(line, "%li %127s", &offset, name) != 2) continue;
+		if (hm->num_names == size) {
+			size = size ? 2 * size : 64;
+			hm->names = g_renew(RTLRegName, hm->names, size);
+		}
+		hm->names[hm->num_names++] = (RTLRegName) { .offset = offset, .name = g_strdup(name) };
+	}
+	fclose(f);
+	qsort(hm->names, hm->num_names, sizeof *hm->names, rtl_regname_compare);
+	return true;
+}
+
+static char *rtl_regname (RTLHeatmap *hm, uint32_t offset)
+{
+	// registers not in the map are named after the nearest one below them, e.g. "tmr1+0x4":
+	const RTLRegName *n = NULL;
+	for (unsigned lo = 0, hi = hm->num_names; lo < hi; ) {
+		unsigned mid = (lo + hi) / 2;
+		if (hm->names[mid].offset <= offset) {
+			n = &hm->names[mid];
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (!n) return g_strdup("");
+	if (n->offset == offset) return g_strdup(n->name);
+	return g_strdup_printf("%s+0x%x", n->name, offset - n->offset);
+}
+
+static char *rtl_json_string (const char *s)
+{
+	// names come from the user's register map and the ELF symbol table, so quote them
+	// for JSON, passing valid UTF-8 through and taking any other byte as Latin-1:
+	bool utf8 = g_utf8_validate(s, -1, NULL);
+	GString *out = g_string_sized_new(strlen(s) + 2);
+	for (const unsigned char *c = (const unsigned char *) s; *c; ++c) {
+		if (*c == '"' || *c == '\\') {
+			g_string_append_c(out, '\\');
+			g_string_append_c(out, *c);
+		} else if (*c < 0x20 || *c == 0x7F || (*c >= 0x80 && !utf8)) {
+			g_string_append_printf(out, "\\u%04x", *c);
+		} else {
+			g_string_append_c(out, *c);
+		}
+	}
+	return g_string_free(out, false);
+}
+
+static int rtl_heatreg_compare (const void *a, const void *b)
+{
+	// most time-consuming registers first:
+	const RTLHeatReg *x = *(RTLHeatReg * const *) a, *y = *(RTLHeatReg * const *) b;
+	return x->stall_ns > y->stall_ns ? -1 : x->stall_ns < y->stall_ns;
+}
+
+static void rtl_heatmap_dump (Notifier *notifier, void *data)
+{
+	RTLHeatmap *hm = container_of(notifier, RTLHeatmap, exit);
+	FILE *f = fopen(hm->file, "w");
+	if (!f) {
+		error_report("RTL-bridge: cannot create '%s': %s", hm->file, strerror(errno));
+		return;
+	}
+	guint count;
+	RTLHeatReg **regs = (RTLHeatReg **) g_hash_table_get_values_as_array(hm->regs, &count);
+	qsort(regs, count, sizeof *regs, rtl_heatreg_compare);
+	if (!hm->json) {
+		fprintf(f, "%-10s %-24s %10s %10s %12s %10s  %s\n",
+			"offset", "register", "reads", "writes", "stall [ms]", "avg [µs]", "top guest PCs (accesses)");
+	}
+	for (guint i = 0; i < count; ++i) {
+		RTLHeatReg *r = regs[i];
+		g_autofree char *name = rtl_regname(hm, r->offset);
+		uint64_t accesses = r->reads + r->writes;
+		if (hm->json) {
+			g_autofree char *quoted = rtl_json_string(name);
+			fprintf(f, "{\"offset\":%u,\"register\":\"%s\",\"reads\":%"PRIu64",\"writes\":%"PRIu64
+				",\"stall_ns\":%"PRId64",\"pcs\":[", r->offset, quoted, r->reads, r->writes, r->stall_ns);
+		} else {
+			fprintf(f, "0x%08X %-24s %10"PRIu64" %10"PRIu64" %12.3f %10.3f ", r->offset, name,
+				r->reads, r->writes, r->stall_ns * 1e-6, accesses ? r->stall_ns * 1e-3 / accesses : 0.0);
+		}
+		for (int j = 0; j < top_pcs && r->top[j].count; ++j) {
+			const char *sym = lookup_symbol(r->top[j].pc);
+			if (hm->json) {
+				g_autofree char *quoted = rtl_json_string(sym);
+				fprintf(f, "%s{\"pc\":%"PRIu64",\"symbol\":\"%s\",\"count\":%"PRIu64"}",
+					j ? "," : "", (uint64_t) r->top[j].pc, quoted, r->top[j].count);
+			} else {
+				fprintf(f, " %s@0x%"PRIx64" (%"PRIu64")", sym, (uint64_t) r->top[j].pc, r->top[j].count);
+			}
+		}
+		fprintf(f, hm->json ? "]}\n" : "\n");
+	}
+	g_free(regs);
+	fclose(f);
+}
+
+RTLHeatmap *rtl_heatmap_create (const char *file, const char *regmap, Error **errp)
+{
+	RTLHeatmap *hm = g_new0(RTLHeatmap, 1);
+	if (regmap && !rtl_regmap_load(hm, regmap, errp)) {
+		g_free(hm);
+		return NULL;
+	}
+	hm->regs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	hm->file = g_strdup(file);
+	hm->json = g_str_has_suffix(file, ".json");
+	hm->exit.notify = rtl_heatmap_dump;
+	qemu_add_exit_notifier(&hm->exit);
+	return hm;
+}
+
+void rtl_heatmap_access (RTLHeatmap *hm, uint32_t offset, bool write, int64_t stall_ns)
+{
+	offset &= ~3;
+	RTLHeatReg *r = g_hash_table_lookup(hm->regs, GUINT_TO_POINTER(offset));
+	if (!r) {
+		r = g_new0(RTLHeatReg, 1);
+		r->offset = offset;
+		g_hash_table_insert(hm->regs, GUINT_TO_POINTER(offset), r);
+	}
+	if (write) ++r->writes; else ++r->reads;
+	r->stall_ns += stall_ns;
+	if (!current_cpu) return;
+
+	// keep the most frequent PCs, replacing the least frequent one when there is no room
+	// (space-saving algorithm: counts of replaced entries are inherited, so they are upper bounds):
+	vaddr pc = CPU_GET_CLASS(current_cpu)->get_pc(current_cpu);
+	int j, min = 0;
+	for (j = 0; j < top_pcs && r->top[j].count; ++j) {
+		if (r->top[j].pc == pc) break;
+		if (r->top[j].count < r->top[min].count) min = j;
+	}
+	if (j == top_pcs) {
+		j = min;
+		r->top[j].pc = pc;
+	} else if (!r->top[j].count) {
+		r->top[j].pc = pc;
+	}
+	++r->top[j].count;
+	// keep entries sorted by count:
+	for (; j > 0 && r->top[j].count > r->top[j - 1].count; --j) {
+		typeof(r->top[0]) t = r->top[j];
+		r->top[j] = r->top[j - 1];
+		r->top[j - 1] = t;
+	}
+}
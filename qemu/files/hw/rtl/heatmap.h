@@ -0,0 +1,26 @@
+/*
+ * Per-register access statistics of the RTL bridge
+ *
+ * Author:
+ *	Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *	Department of Information Engineering
+ *	Università Politecnica delle Marche (ITALY)
+ *
+ * This file Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef HW_RTL_HEATMAP_H
+#define HW_RTL_HEATMAP_H
+
+typedef struct RTLHeatmap RTLHeatmap;
+
+// statistics are written at exit to "file", as a table or, if its name ends in ".json",
+// as JSON lines; "regmap" optionally names a file of "OFFSET NAME" lines to label registers:
+RTLHeatmap *rtl_heatmap_create (const char *file, const char *regmap, Error **errp);
+
+// account an access to the register at "offset", that kept the vCPU waiting for "stall_ns":
+void        rtl_heatmap_access (RTLHeatmap *hm, uint32_t offset, bool write, int64_t stall_ns);
+
+#endif
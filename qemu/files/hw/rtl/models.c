@@ -0,0 +1,594 @@
+/*
+ * Functional models of the example peripherals, for hybrid co-simulation
+ *
+ * Author:
+ *	Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *	Department of Information Engineering
+ *	Università Politecnica delle Marche (ITALY)
+ *
+ * This file Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// These models mirror the register-level behaviour of the VHDL peripherals in the
+// examples (serial.vhdl, pwm.vhdl, intc.vhdl, ramc.vhdl), so that the parts of a
+// design that are not under test can be served in nanoseconds by QEMU itself,
+// while the bridge forwards only the remaining address ranges to GHDL.
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qemu/error-report.h"
+#include "models.h"
+
+#include <math.h>
+
+enum { max_models = 16, fifo_size = 2048 };
+
+typedef struct RTLModel RTLModel;
+
+enum model_kind { model_uart, model_pwm, model_intc, model_sram };
+
+typedef struct RTLModelType {
+	enum model_kind        kind;
+	const char            *name;
+	uint64_t               size;
+	const MemoryRegionOps *ops;
+	void                 (*reset)(RTLModel *m);
+} RTLModelType;
+
+struct RTLModel {
+	const RTLModelType *type;
+	RTLModels          *models;
+	MemoryRegion        iomem;
+	hwaddr              offset;
+	int                 irq_line;   // -1 if the model does not drive an IRQ line
+	bool                irq;
+	union {
+		struct {
+			uint16_t    rx[fifo_size];  // 9-bit codes, as read from the data register
+			unsigned    rx_head, rx_count, rx_special;
+			bool        rx_enable, rx_over;
+			bool        tx_enable, tx_level, tx_over;
+			bool        loopback, enable_rts, enable_cts;
+			uint8_t     irq_mask;
+		} uart;
+		struct {
+			uint32_t    period;
+			uint32_t    value;
+			uint64_t    start;      // VHDL clock cycle at which the counter was last at 0
+			uint64_t    acked;      // counter wraps acknowledged by reading the count
+			QEMUTimer  *timer;
+		} pwm;
+		struct {
+			uint32_t    enable;
+		} intc;
+	};
+};
+
+struct RTLModels {
+	RTLModelHost  host;
+	RTLModel     *model[max_models];
+	int           count;
+	RTLModel     *uart;             // the only one that can be connected to the chardev
+	RTLModel     *intc;
+	uint32_t      lines;            // IRQ lines as last seen by the INTC model
+	// model time origin, moved forward whenever "sync" changes (e.g. when calibrating):
+	uint32_t      sync;             // value in effect since the origin
+	int64_t       origin_ns;        // virtual time of the origin
+	uint64_t      origin_cycles;    // model time at the origin
+};
+
+
+// model time, in VHDL clock cycles, is virtual time scaled by the bridge "sync";
+// as "sync" may change, time is accumulated piecewise, so that it never goes back:
+
+static double model_cycle_ns (RTLModels *ms)
+{
+	return 1e9 * ms->sync / ms->host.hdl_clk;
+}
+
+static uint64_t model_cycles (RTLModels *ms)
+{
+	int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+	if (*ms->host.sync != ms->sync) {
+		ms->origin_cycles += (now - ms->origin_ns) / model_cycle_ns(ms);
+		ms->origin_ns      = now;
+		ms->sync           = *ms->host.sync;
+	}
+	return ms->origin_cycles + (uint64_t) ((now - ms->origin_ns) / model_cycle_ns(ms));
+}
+
+static int64_t model_cycles_ns (RTLModels *ms, uint64_t cycles)
+{
+	// virtual time at which model time reaches "cycles", at the current rate:
+	if (cycles < ms->origin_cycles) return ms->origin_ns;
+	return ms->origin_ns + ceil((cycles - ms->origin_cycles) * model_cycle_ns(ms));
+}
+
+static void model_set_irq (RTLModel *m, bool level)
+{
+	if (m->irq == level) return;
+	m->irq = level;
+	m->models->host.update_irq(m->models->host.opaque);
+}
+
+// registers are 32-bit wide, with byte strobes as on the AXI bus:
+static void model_lanes (hwaddr addr, uint64_t val, unsigned size, uint32_t *data, uint8_t *mask)
+{
+	*data = val << (addr & 3) * 8;
+	*mask = ((1 << size) - 1) << (addr & 3);
+}
+
+
+// fastUART (serial.vhdl), with an instantaneous transmitter:
+
+static void uart_update (RTLModel *m)
+{
+	bool rx_empty = !m->uart.rx_count;
+	bool rx_half  = m->uart.rx_count >= fifo_size / 2;
+	bool rx_ready = m->uart.rx_special;
+	uint8_t raw = 1 << 5 | rx_ready << 4 | 1 << 3 | 1 << 2 | rx_half << 1 | !rx_empty;
+	model_set_irq(m, raw & m->uart.irq_mask);
+}
+
+static void uart_push (RTLModel *m, uint16_t code)
+{
+	if (!m->uart.rx_enable) return;
+	if (m->uart.rx_count == fifo_size) {
+		m->uart.rx_over = true;
+		return;
+	}
+	m->uart.rx[(m->uart.rx_head + m->uart.rx_count++) % fifo_size] = code;
+	if (code & 0x100) ++m->uart.rx_special;
+}
+
+static uint16_t uart_pop (RTLModel *m)
+{
+	if (!m->uart.rx_count) return 0x119;
+	uint16_t code = m->uart.rx[m->uart.rx_head];
+	m->uart.rx_head = (m->uart.rx_head + 1) % fifo_size;
+	--m->uart.rx_count;
+	if (code & 0x100) --m->uart.rx_special;
+	qemu_chr_fe_accept_input(m->models->host.chr);
+	return code;
+}
+
+static int uart_can_receive (void *opaque)
+{
+	RTLModel *m = opaque;
+	// leave room for the idle marker that follows each burst:
+	return m->uart.rx_enable ? MAX(0, fifo_size - 1 - (int) m->uart.rx_count) : 0;
+}
+
+static void uart_receive (void *opaque, const uint8_t *buf, int size)
+{
+	RTLModel *m = opaque;
+	for (int i = 0; i < size; ++i)
+		uart_push(m, buf[i]);
+	// the receiver detects the line going idle after each burst:
+	uart_push(m, 0x100);
+	uart_update(m);
+}
+
+static void uart_event (void *opaque, QEMUChrEvent event)
+{
+	RTLModel *m = opaque;
+	if (event == CHR_EVENT_OPENED) uart_push(m, 0x100); // idle
+	if (event == CHR_EVENT_CLOSED) uart_push(m, 0x104); // break
+	uart_update(m);
+}
+
+static void uart_transmit (RTLModel *m, uint16_t code)
+{
+	if (m->uart.loopback) {
+		// what the receiver would decode of a break, idle or framing error symbol:
+		if (code == 0x1FE) code = 0x115;
+		if (code == 0x1C0) code = 0x104;
+		if (code == 0x1C1) code = 0x100;
+		uart_push(m, code);
+	} else if (!(code & 0x100)) {
+		uint8_t c = code;
+		qemu_chr_fe_write_all(m->models->host.chr, &c, 1);
+	}
+}
+
+static uint64_t uart_read (void *opaque, hwaddr addr, unsigned size)
+{
+	RTLModel *m = opaque;
+	uint32_t val = 0;
+	switch (addr >> 2 & 7) {
+		case 0:
+			val = uart_pop(m);
+			break;
+		case 1:
+			// TX FIFO always empty and idle, RX line always high (idle):
+			val = m->uart.irq_mask << 24
+			    | m->uart.loopback << 23 | m->uart.enable_rts << 21 | m->uart.enable_cts << 20
+			    | m->uart.rx_enable << 15 | 1 << 13 | (m->uart.rx_special > 0) << 12 | m->uart.rx_over << 11
+			    | (m->uart.rx_count == fifo_size) << 10 | (m->uart.rx_count >= fifo_size / 2) << 9 | !m->uart.rx_count << 8
+			    | m->uart.tx_enable << 7 | m->uart.tx_level << 5 | m->uart.tx_over << 3 | 1 << 1 | 1 << 0;
+			break;
+		default:
+			qemu_log_mask(LOG_GUEST_ERROR, "RTL-bridge: uart model: bad read offset 0x%"HWADDR_PRIx"\n", addr);
+	}
+	uart_update(m);
+	return val >> (addr & 3) * 8;
+}
+
+static void uart_write (void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+	RTLModel *m = opaque;
+	uint32_t data;
+	uint8_t  mask;
+	model_lanes(addr, val, size, &data, &mask);
+	switch (addr >> 2 & 7) {
+		case 0:
+			for (int i = 0; i < 4; ++i)
+				if (mask & 1 << i) uart_transmit(m, data >> 8 * i & 0xFF);
+			break;
+		case 1:
+			if (mask & 1) {
+				m->uart.tx_enable = data >> 7 & 1;
+				m->uart.tx_level  = data >> 5 & 1;
+				if (data & 0x10) uart_transmit(m, data & 0x40 ? 0x1FE : 0x1C0 | (data >> 5 & 1));
+				if (data & 0x08) m->uart.tx_over = false;
+			}
+			if (mask & 2) {
+				bool enable = data >> 15 & 1;
+				if (data & 0x0800) m->uart.rx_over = false;
+				if (enable && !m->uart.rx_enable) {
+					m->uart.rx_enable = true;
+					qemu_chr_fe_accept_input(m->models->host.chr);
+				}
+				m->uart.rx_enable = enable;
+			}
+			if (mask & 4) {
+				m->uart.loopback   = data >> 23 & 1;
+				m->uart.enable_rts = data >> 21 & 1;
+				m->uart.enable_cts = data >> 20 & 1;
+			}
+			if (mask & 8) {
+				m->uart.irq_mask = data >> 24;
+			}
+			break;
+		default:
+			qemu_log_mask(LOG_GUEST_ERROR, "RTL-bridge: uart model: bad write offset 0x%"HWADDR_PRIx"\n", addr);
+	}
+	uart_update(m);
+}
+
+static void uart_reset (RTLModel *m)
+{
+	memset(&m->uart, 0, sizeof m->uart);
+	uart_update(m);
+}
+
+
+// PWM timer (pwm.vhdl):
+
+static uint32_t pwm_count (RTLModel *m, uint64_t now)
+{
+	if (!m->pwm.period) return 0;
+	return (now - m->pwm.start) % ((uint64_t) m->pwm.period + 1);
+}
+
+static uint64_t pwm_wraps (RTLModel *m, uint64_t now)
+{
+	if (!m->pwm.period) return 0;
+	return (now - m->pwm.start) / ((uint64_t) m->pwm.period + 1);
+}
+
+static void pwm_update (RTLModel *m)
+{
+	uint64_t now = model_cycles(m->models);
+	bool pending = pwm_wraps(m, now) > m->pwm.acked;
+	model_set_irq(m, pending);
+	if (pending || !m->pwm.period) {
+		timer_del(m->pwm.timer);
+		return;
+	}
+	// wake up at the next counter wrap:
+	uint64_t next = m->pwm.start + (m->pwm.acked + 1) * ((uint64_t) m->pwm.period + 1);
+	timer_mod(m->pwm.timer, model_cycles_ns(m->models, next));
+}
+
+static void pwm_timer_cb (void *opaque)
+{
+	pwm_update(opaque);
+}
+
+static uint64_t pwm_read (void *opaque, hwaddr addr, unsigned size)
+{
+	RTLModel *m = opaque;
+	uint64_t now = model_cycles(m->models);
+	uint32_t val = 0;
+	switch (addr >> 2 & 3) {
+		case 0:
+			// reading the count acknowledges the IRQ:
+			val = pwm_count(m, now);
+			m->pwm.acked = pwm_wraps(m, now);
+			pwm_update(m);
+			break;
+		case 1: val = m->pwm.period; break;
+		case 2: val = m->pwm.value;  break;
+	}
+	return val >> (addr & 3) * 8;
+}
+
+static void pwm_write (void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+	RTLModel *m = opaque;
+	uint64_t now = model_cycles(m->models);
+	uint32_t data;
+	uint8_t  mask;
+	model_lanes(addr, val, size, &data, &mask);
+	switch (addr >> 2 & 3) {
+		case 1:
+			// the counter keeps running on a period change, and starts from 0 when enabled:
+			if (m->pwm.period && data) {
+				uint32_t count = pwm_count(m, now);
+				m->pwm.start = now - MIN(count, data);
+			} else {
+				m->pwm.start = now;
+			}
+			m->pwm.acked  = 0;
+			m->pwm.period = data;
+			pwm_update(m);
+			break;
+		case 2:
+			m->pwm.value = data;
+			break;
+		default:
+			qemu_log_mask(LOG_GUEST_ERROR, "RTL-bridge: pwm model: bad write offset 0x%"HWADDR_PRIx"\n", addr);
+	}
+}
+
+static void pwm_reset (RTLModel *m)
+{
+	m->pwm.period = 0;
+	m->pwm.value  = 0;
+	m->pwm.start  = 0;
+	m->pwm.acked  = 0;
+	pwm_update(m);
+}
+
+
+// interrupt controller (intc.vhdl), taking both RTL and model IRQ lines as inputs:
+
+static uint64_t intc_read (void *opaque, hwaddr addr, unsigned size)
+{
+	RTLModel *m = opaque;
+	uint32_t inputs = m->models->lines & 0xFF;
+	uint32_t val = 0;
+	switch (addr >> 2 & 3) {
+		case 0: val = inputs;                  break;
+		case 1: val = inputs & m->intc.enable; break;
+		case 2: val = m->intc.enable;          break;
+	}
+	return val >> (addr & 3) * 8;
+}
+
+static void intc_write (void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+	RTLModel *m = opaque;
+	uint32_t data;
+	uint8_t  mask;
+	model_lanes(addr, val, size, &data, &mask);
+	if ((addr >> 2 & 3) != 2) {
+		qemu_log_mask(LOG_GUEST_ERROR, "RTL-bridge: intc model: bad write offset 0x%"HWADDR_PRIx"\n", addr);
+		return;
+	}
+	for (int i = 0; i < 4; ++i)
+		if (mask & 1 << i) m->intc.enable = (m->intc.enable & ~(0xFFu << 8 * i)) | (data & 0xFFu << 8 * i);
+	m->models->host.update_irq(m->models->host.opaque);
+}
+
+static void intc_reset (RTLModel *m)
+{
+	m->intc.enable = 0;
+}
+
+
+static const MemoryRegionOps uart_ops = {
+	.read  = uart_read,
+	.write = uart_write,
+	.endianness = DEVICE_NATIVE_ENDIAN,
+	.valid = {.min_access_size = 1, .max_access_size = 4},
+};
+
+static const MemoryRegionOps pwm_ops = {
+	.read  = pwm_read,
+	.write = pwm_write,
+	.endianness = DEVICE_NATIVE_ENDIAN,
+	.valid = {.min_access_size = 1, .max_access_size = 4},
+};
+
+static const MemoryRegionOps intc_ops = {
+	.read  = intc_read,
+	.write = intc_write,
+	.endianness = DEVICE_NATIVE_ENDIAN,
+	.valid = {.min_access_size = 1, .max_access_size = 4},
+};
+
+static const RTLModelType model_types[] = {
+	{model_uart, "uart", 0x1000,  &uart_ops, uart_reset},
+	{model_pwm,  "pwm",  0x1000,  &pwm_ops,  pwm_reset},
+	{model_intc, "intc", 0x1000,  &intc_ops, intc_reset},
+	{model_sram, "sram", 0x10000, NULL,      NULL},       // plain RAM, as the controller has no side effects
+};
+
+
+static RTLModel *model_create (RTLModels *ms, const char *item, Error **errp)
+{
+	// TYPE@OFFSET[:IRQ]
+	char type[8];
+	unsigned long long offset;
+	int irq = ms->count, n = 0;
+	if (sscanf(item, " %7[a-z]@%lli%n:%i%n", type, &offset, &n, &irq, &n) < 2 || item[n]) {
+		error_setg(errp, "RTL-bridge: bad model specification '%s'", item);
+		return NULL;
+	}
+	const RTLModelType *t = NULL;
+	for (int i = 0; i < ARRAY_SIZE(model_types); ++i)
+		if (!strcmp(type, model_types[i].name)) t = &model_types[i];
+	if (!t) {
+		error_setg(errp, "RTL-bridge: unknown model type '%s'", type);
+		return NULL;
+	}
+	if (irq < 0 || irq > 31) {
+		error_setg(errp, "RTL-bridge: bad IRQ line in '%s'", item);
+		return NULL;
+	}
+	if (t->kind == model_intc && !ms->host.irq_sources) {
+		// otherwise its inputs would only be the output of the RTL one, which it replaces:
+		error_setg(errp, "RTL-bridge: the intc model needs the raw IRQ sources from VHDL (irq-sources=on)");
+		return NULL;
+	}
+	if ((t->kind == model_uart && ms->uart) || (t->kind == model_intc && ms->intc)) {
+		error_setg(errp, "RTL-bridge: only one %s model is supported", type);
+		return NULL;
+	}
+
+	RTLModel *m = g_new0(RTLModel, 1);
+	m->type     = t;
+	m->models   = ms;
+	m->offset   = offset;
+	m->irq_line = t->kind == model_uart || t->kind == model_pwm ? irq : -1;
+	char *name  = g_strdup_printf("RTL-model-%s@0x%"HWADDR_PRIx, type, m->offset);
+	Error *err  = NULL;
+	if (t->ops) {
+		memory_region_init_io(&m->iomem, ms->host.owner, t->ops, m, name, t->size);
+	} else {
+		memory_region_init_ram(&m->iomem, ms->host.owner, name, t->size, &err);
+	}
+	g_free(name);
+	if (err) {
+		error_propagate(errp, err);
+		g_free(m);
+		return NULL;
+	}
+	switch (t->kind) {
+		case model_uart:
+			ms->uart = m;
+			qemu_chr_fe_set_handlers(ms->host.chr, uart_can_receive, uart_receive, uart_event, NULL, m, NULL, true);
+			break;
+		case model_pwm:
+			m->pwm.timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, pwm_timer_cb, m);
+			break;
+		case model_intc:
+			ms->intc = m;
+			break;
+		case model_sram:
+			break;
+	}
+	// models take precedence over the bridge for their address range:
+	memory_region_add_subregion_overlap(ms->host.container, m->offset, &m->iomem, 1);
+	return m;
+}
+
+static void model_handover (RTLModel *m)
+{
+	// replay the model state into the VHDL peripheral through bus writes:
+	RTLModels *ms = m->models;
+	uint32_t base = m->offset;
+	switch (m->type->kind) {
+		case model_uart:
+			if (m->uart.rx_count) {
+				warn_report("RTL-bridge: %u characters in the uart model RX FIFO are lost", m->uart.rx_count);
+			}
+			ms->host.write(ms->host.opaque, base + 4, m->uart.irq_mask << 24
+				| m->uart.loopback << 23 | m->uart.enable_rts << 21 | m->uart.enable_cts << 20
+				| m->uart.rx_enable << 15 | m->uart.tx_enable << 7 | m->uart.tx_level << 5, 0xF);
+			qemu_chr_fe_set_handlers(ms->host.chr, NULL, NULL, NULL, NULL, NULL, NULL, true);
+			ms->uart = NULL;
+			break;
+		case model_pwm:
+			// the VHDL counter restarts from 0, so the phase of the PWM is not preserved:
+			ms->host.write(ms->host.opaque, base + 8, m->pwm.value,  0xF);
+			ms->host.write(ms->host.opaque, base + 4, m->pwm.period, 0xF);
+			timer_del(m->pwm.timer);
+			break;
+		case model_intc:
+			ms->host.write(ms->host.opaque, base + 8, m->intc.enable, 0xF);
+			ms->intc = NULL;
+			break;
+		case model_sram: {
+			const uint32_t *ram = memory_region_get_ram_ptr(&m->iomem);
+			for (uint32_t i = 0; i < m->type->size / 4; ++i)
+				ms->host.write(ms->host.opaque, base + 4 * i, ram[i], 0xF);
+			break;
+		}
+	}
+	memory_region_del_subregion(ms->host.container, &m->iomem);
+}
+
+bool rtl_models_switch (RTLModels *ms, uint64_t offset)
+{
+	bool found = false;
+	for (int i = 0; i < ms->count; ) {
+		RTLModel *m = ms->model[i];
+		if (offset != RTL_MODELS_ALL && m->offset != offset) {
+			++i;
+			continue;
+		}
+		model_handover(m);
+		memmove(&ms->model[i], &ms->model[i + 1], (ms->count - i - 1) * sizeof *ms->model);
+		--ms->count;
+		found = true;
+		// the model is kept allocated, as its memory region may still be referenced.
+	}
+	if (found) ms->host.update_irq(ms->host.opaque);
+	return found;
+}
+
+char *rtl_models_spec (RTLModels *ms)
+{
+	GString *spec = g_string_new("");
+	for (int i = 0; i < ms->count; ++i) {
+		RTLModel *m = ms->model[i];
+		g_string_append_printf(spec, "%s%s@0x%"HWADDR_PRIx, i ? "," : "", m->type->name, m->offset);
+		if (m->irq_line >= 0) g_string_append_printf(spec, ":%d", m->irq_line);
+	}
+	return g_string_free(spec, false);
+}
+
+RTLModels *rtl_models_create (const RTLModelHost *host, const char *spec, Error **errp)
+{
+	RTLModels *ms = g_new0(RTLModels, 1);
+	ms->host = *host;
+	ms->sync = *host->sync;
+	char **items = g_strsplit(spec, ",", -1);
+	for (char **item = items; *item; ++item) {
+		if (!**item) continue;
+		if (ms->count == max_models) {
+			error_setg(errp, "RTL-bridge: too many models");
+			break;
+		}
+		RTLModel *m = model_create(ms, *item, errp);
+		if (!m) break;
+		ms->model[ms->count++] = m;
+	}
+	g_strfreev(items);
+	return ms;
+}
+
+void rtl_models_reset (RTLModels *ms)
+{
+	for (int i = 0; i < ms->count; ++i)
+		if (ms->model[i]->type->reset) ms->model[i]->type->reset(ms->model[i]);
+}
+
+uint32_t rtl_models_irq (RTLModels *ms, uint32_t rtl_lines)
+{
+	uint32_t models = 0;
+	for (int i = 0; i < ms->count; ++i)
+		if (ms->model[i]->irq && ms->model[i]->irq_line >= 0) models |= 1u << ms->model[i]->irq_line;
+	// the INTC model takes the raw RTL sources, if available, together with the model IRQs:
+	ms->lines = (ms->host.irq_sources ? rtl_lines & 0xFF : 0) | models;
+	if (ms->intc) return (ms->lines & ms->intc->intc.enable & 0xFF) != 0;
+	// without it, the RTL one (if any) is bypassed by the model IRQs:
+	return (ms->host.irq_sources ? rtl_lines >> 8 & 1 : rtl_lines) || models;
+}
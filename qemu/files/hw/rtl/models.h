@@ -0,0 +1,50 @@
+/*
+ * Functional models of the example peripherals, for hybrid co-simulation
+ *
+ * Author:
+ *	Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *	Department of Information Engineering
+ *	Università Politecnica delle Marche (ITALY)
+ *
+ * This file Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef HW_RTL_MODELS_H
+#define HW_RTL_MODELS_H
+
+#include "exec/memory.h"
+#include "chardev/char-fe.h"
+
+typedef struct RTLModels RTLModels;
+
+// what the models need from the bridge hosting them:
+typedef struct RTLModelHost {
+	Object             *owner;
+	MemoryRegion       *container;  // bridge I/O space, models are overlaid on it
+	const uint32_t     *sync;       // virtual µs per VHDL µs
+	uint32_t            hdl_clk;    // VHDL clock frequency [Hz]
+	bool                irq_sources; // RTL IRQ lines are the raw sources (7..0) plus the RTL INTC output (8)
+	CharBackend        *chr;        // host side of the modelled UART (may be unconnected)
+	void              (*update_irq)(void *opaque);
+	void              (*write)(void *opaque, uint32_t addr, uint32_t data, uint8_t mask); // VHDL bus write
+	void               *opaque;
+} RTLModelHost;
+
+// "spec" is a comma-separated list of TYPE@OFFSET[:IRQ] items, with TYPE being
+// one of uart, pwm, intc, sram; IRQ is the interrupt source number of the model,
+// i.e. its bit position among the RTL IRQ lines (defaults to its list position).
+RTLModels *rtl_models_create (const RTLModelHost *host, const char *spec, Error **errp);
+void       rtl_models_reset  (RTLModels *models);
+
+// hand the model at "offset" (or all of them) over to VHDL, replaying its state through
+// bus writes, and return false if there was none; current models are listed by rtl_models_spec:
+#define RTL_MODELS_ALL UINT64_MAX
+bool       rtl_models_switch (RTLModels *models, uint64_t offset);
+char      *rtl_models_spec   (RTLModels *models);
+
+// combine IRQ lines coming from RTL with those of the models into the CPU IRQ level:
+uint32_t   rtl_models_irq    (RTLModels *models, uint32_t rtl_lines);
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * Firmware trace port of the RTL bridge
+ *
+ * Author:
+ *	Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *	Department of Information Engineering
+ *	Università Politecnica delle Marche (ITALY)
+ *
+ * This file Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// A small I/O region handled by QEMU alone, so that firmware can log events
+// for the cost of a few stores, without involving VHDL. Registers:
+//	+0x00  W: format ID, appends a record with the arguments written since the last one
+//	       R: number of records written so far
+//	+0x04  W: argument 1 ... +0x3C  W: argument 15
+// Records are binary and fixed-size, in a memory-mapped ring file, and are
+// expanded offline by qemu/trace-decode, using a table of format strings.
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qemu/error-report.h"
+#include "qemu/thread.h"
+#include "qemu/lockable.h"
+#include "qemu/timer.h"
+#include "tracelog.h"
+
+#include <sys/mman.h>
+
+enum { max_args = 15 };
+
+// file layout, shared with qemu/trace-decode.c:
+typedef struct {
+	char        magic[8];       // "RTLTRACE"
+	uint32_t    version;
+	uint32_t    slots;
+	uint64_t    count;          // records written so far, the last "slots" of them are kept
+	uint8_t     reserved[40];
+} RTLTraceHeader;
+
+typedef struct {
+	uint32_t    format;
+	uint32_t    args;           // number of arguments used
+	int64_t     virt_ns;
+	uint32_t    hdl_us;
+	uint32_t    arg[max_args];
+} RTLTraceRecord;
+
+struct RTLTraceLog {
+	MemoryRegion     iomem;
+	QemuMutex        mutex;     // the region is accessed without the BQL, possibly by several vCPUs
+	RTLTraceHeader  *header;
+	RTLTraceRecord  *ring;
+	const uint32_t  *hdl_time;
+	uint32_t         arg[max_args];
+	uint32_t         args;
+};
+
+static uint64_t rtl_tracelog_read (void *opaque, hwaddr addr, unsigned size)
+{
+	RTLTraceLog *tl = opaque;
+	return addr ? 0 : (uint32_t) qatomic_read(&tl->header->count);
+}
+
+static void rtl_tracelog_write (void *opaque, hwaddr addr, uint64_t val, unsigned size)
+{
+	RTLTraceLog *tl = opaque;
+	unsigned reg = addr / 4;
+	QEMU_LOCK_GUARD(&tl->mutex);
+	if (reg) {
+		tl->arg[reg - 1] = val;
+		if (reg > tl->args) tl->args = reg;
+		return;
+	}
+	uint64_t count = tl->header->count;
+	RTLTraceRecord *r = &tl->ring[count % tl->header->slots];
+	r->format  = val;
+	r->args    = tl->args;
+	r->virt_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+	r->hdl_us  = qatomic_read(tl->hdl_time);
+	memcpy(r->arg, tl->arg, tl->args * sizeof *tl->arg);
+	memset(r->arg + tl->args, 0, (max_args - tl->args) * sizeof *tl->arg);
+	tl->args = 0;
+	// readers only look at records below count:
+	qatomic_store_release(&tl->header->count, count + 1);
+}
+
+static const MemoryRegionOps rtl_tracelog_ops = {
+	.read  = rtl_tracelog_read,
+	.write = rtl_tracelog_write,
+	.endianness = DEVICE_NATIVE_ENDIAN,
+	.valid = {.min_access_size = 4, .max_access_size = 4},
+	.impl  = {.min_access_size = 4, .max_access_size = 4},
+};
+
+RTLTraceLog *rtl_tracelog_create (Object *owner, const char *file, uint32_t slots,
+                                  const uint32_t *hdl_time, Error **errp)
+{
+	if (!slots) {
+		error_setg(errp, "RTL-bridge: trace-slots must not be zero");
+		return NULL;
+	}
+	int fd = open(file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	size_t length = sizeof (RTLTraceHeader) + (size_t) slots * sizeof (RTLTraceRecord);
+	if (fd < 0 || ftruncate(fd, length) < 0) {
+		error_setg(errp, "RTL-bridge: cannot create '%s': %s", file, strerror(errno));
+		if (fd >= 0) close(fd);
+		return NULL;
+	}
+	// shared mapping: records reach the file without system calls, and survive a crash:
+	void *p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		error_setg(errp, "RTL-bridge: cannot map '%s': %s", file, strerror(errno));
+		return NULL;
+	}
+	RTLTraceLog *tl = g_new0(RTLTraceLog, 1);
+	qemu_mutex_init(&tl->mutex);
+	tl->header   = p;
+	tl->ring     = (RTLTraceRecord *) (tl->header + 1);
+	tl->hdl_time = hdl_time;
+	memcpy(tl->header->magic, "RTLTRACE", 8);
+	tl->header->version = 1;
+	tl->header->slots   = slots;
+	memory_region_init_io(&tl->iomem, owner, &rtl_tracelog_ops, tl, "RTL-bridge-trace", 0x40);
+	memory_region_clear_global_locking(&tl->iomem);
+	return tl;
+}
+
+MemoryRegion *rtl_tracelog_region (RTLTraceLog *tl)
+{
+	return &tl->iomem;
+}
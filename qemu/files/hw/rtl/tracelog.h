@@ -0,0 +1,29 @@
+/*
+ * Firmware trace port of the RTL bridge
+ *
+ * Author:
+ *	Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *	Department of Information Engineering
+ *	Università Politecnica delle Marche (ITALY)
+ *
+ * This file Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef HW_RTL_TRACELOG_H
+#define HW_RTL_TRACELOG_H
+
+#include "exec/memory.h"
+
+typedef struct RTLTraceLog RTLTraceLog;
+
+// records go to the last "slots" entries of a ring in "file", time-stamped with
+// virtual time and with the VHDL time last known to the bridge, read from "hdl_time":
+RTLTraceLog  *rtl_tracelog_create (Object *owner, const char *file, uint32_t slots,
+                                   const uint32_t *hdl_time, Error **errp);
+
+// I/O region of the trace port, to be mapped by the bridge:
+MemoryRegion *rtl_tracelog_region (RTLTraceLog *tl);
+
+#endif
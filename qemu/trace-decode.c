@@ -0,0 +1,138 @@
+/*
+ * Decoder of the firmware trace records written by the RTL bridge
+ *
+ * Author:
+ *	Giorgio Biagetti <g.biagetti@staff.univpm.it>
+ *	Department of Information Engineering
+ *	Università Politecnica delle Marche (ITALY)
+ *
+ * This file Copyright © 2023 Giorgio Biagetti
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Usage: trace-decode TRACEFILE FORMATS
+// where FORMATS has one "ID FORMAT" line per trace point, e.g.
+//	1 bank %u ready, %u overruns
+// FORMAT being a printf format with up to 15 32-bit integer conversions
+// (%d, %u, %x, %X, %c, possibly with flags and width). Records are printed
+// oldest first, prefixed by the virtual time and the VHDL time they were
+// written at. The record layout must match hw/rtl/tracelog.c.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+enum { max_args = 15, max_formats = 4096 };
+
+typedef struct {
+	char        magic[8];       // "RTLTRACE"
+	uint32_t    version;
+	uint32_t    slots;
+	uint64_t    count;
+	uint8_t     reserved[40];
+} header_t;
+
+typedef struct {
+	uint32_t    format;
+	uint32_t    args;
+	int64_t     virt_ns;
+	uint32_t    hdl_us;
+	uint32_t    arg[max_args];
+} record_t;
+
+static char *formats[max_formats];
+
+static void load_formats (const char *name)
+{
+	FILE *f = fopen(name, "r");
+	if (!f) {
+		perror(name);
+		exit(1);
+	}
+	char line[512];
+	while (fgets(line, sizeof line, f)) {
+		char *text;
+		unsigned long id = strtoul(line, &text, 0);
+		if (text == line || id >= max_formats) continue;
+		text += strspn(text, " \t");
+		text[strcspn(text, "\r\n")] = '\0';
+		free(formats[id]);
+		formats[id] = strdup(text);
+	}
+	fclose(f);
+}
+
+static void print_record (const record_t *r)
+{
+	printf("%12.6f ms  %10u µs  ", r->virt_ns * 1e-6, r->hdl_us);
+	const char *f = r->format < max_formats ? formats[r->format] : NULL;
+	if (!f) {
+		// unknown trace point, dump it raw:
+		printf("#%u", r->format);
+		for (uint32_t i = 0; i < r->args && i < max_args; ++i) printf(" 0x%08X", r->arg[i]);
+		putchar('\n');
+		return;
+	}
+	// expand one conversion at a time, as the arguments are only known at run time:
+	unsigned next = 0;
+	while (*f) {
+		if (*f != '%') {
+			putchar(*f++);
+			continue;
+		}
+		if (f[1] == '%') {
+			putchar('%');
+			f += 2;
+			continue;
+		}
+		size_t n = 1 + strspn(f + 1, "-+ #0123456789");
+		char spec[32];
+		if (!strchr("diuxXc", f[n]) || n + 2 > sizeof spec) {
+			// not supported: print it as is
+			fwrite(f, 1, n, stdout);
+			f += n;
+			continue;
+		}
+		memcpy(spec, f, n + 1);
+		spec[n + 1] = '\0';
+		uint32_t arg = next < max_args ? r->arg[next++] : 0;
+		if (f[n] == 'd' || f[n] == 'i') printf(spec, (int32_t) arg); else printf(spec, arg);
+		f += n + 1;
+	}
+	putchar('\n');
+}
+
+int main (int argc, char *argv[])
+{
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s TRACEFILE FORMATS\n", argv[0]);
+		return 1;
+	}
+	load_formats(argv[2]);
+	FILE *f = fopen(argv[1], "rb");
+	if (!f) {
+		perror(argv[1]);
+		return 1;
+	}
+	header_t h;
+	if (fread(&h, sizeof h, 1, f) != 1 || memcmp(h.magic, "RTLTRACE", 8) || h.version != 1 || !h.slots) {
+		fprintf(stderr, "%s: not a trace file\n", argv[1]);
+		return 1;
+	}
+	// the ring keeps the last "slots" records:
+	uint64_t first = h.count > h.slots ? h.count - h.slots : 0;
+	if (first) fprintf(stderr, "%s: %" PRIu64 " older records were overwritten\n", argv[1], first);
+	for (uint64_t i = first; i < h.count; ++i) {
+		record_t r;
+		if (fseek(f, sizeof h + (i % h.slots) * sizeof r, SEEK_SET) || fread(&r, sizeof r, 1, f) != 1) {
+			fprintf(stderr, "%s: truncated\n", argv[1]);
+			return 1;
+		}
+		print_record(&r);
+	}
+	fclose(f);
+	return 0;
+}